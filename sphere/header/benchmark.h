@@ -0,0 +1,52 @@
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#include<stddef.h>
+#include<string>
+#include<vector>
+#include"shader.h"
+
+struct benchmark_options {
+	int width = 600;
+	int height = 800;
+	int frames = 300;
+	int warmup_frames = 10;
+	int min_level = 1;
+	int max_level = 7;
+	int generation_repeats = 3;
+	double radius = 10.0;
+	unsigned threads = 0; //generation pool size, 0 uses every hardware thread
+	bool tessellation = false; //also render the path with tessellated_sphere, needs GL 4.0
+	bool chunks = false; //also render the path with sphere_chunks, streaming chunks in as it goes
+	int impostors = 0; //spheres to ray cast around the main one in an extra pass over the path, 0 skips it
+	const char* csv_path = NULL;
+	const char* json_path = NULL;
+	const char* trace_path = NULL; //Chrome trace of the profiled zones, see profiler.h
+};
+
+//One measurement; gpu_ms is negative when timer queries are unavailable
+struct benchmark_sample {
+	std::string section; //generate, generate_parallel, optimize, displace, displace_patch, adjacency, locate, diffuse, upload, frame, frame_tessellated, frame_chunked or frame_impostors
+	int level;
+	int index; //repeat or frame number
+	double cpu_ms;
+	double gpu_ms;
+	size_t triangles; //submitted, lookups for locate; frames count only patches that survived culling, tessellated frames count base triangles, impostors two each
+};
+
+/*----- BENCHMARK REPORT -----*/
+class benchmark_report {
+public:
+	std::vector<benchmark_sample> samples;
+
+	void add(const char* section, int level, int index, double cpu_ms, double gpu_ms, size_t triangles);
+	bool write_csv(const char* file_path) const;
+	bool write_json(const char* file_path, const benchmark_options& options) const;
+	void print_summary() const;
+};
+
+//Times mesh generation and upload per level, then renders options.frames frames along a scripted camera
+//path into the current framebuffer. Needs a current GL context; program is the scene's shader program.
+bool run_benchmark(const benchmark_options& options, shader_program* program, benchmark_report* report);
+
+#endif // !__BENCHMARK_H__
@@ -40,6 +40,7 @@ public:
 
 	void process_keyboard(camera_movement movement, float delta_time);
 	void process_mouse(double x_offset, double y_offest, bool constrain_pitch = true);
+	void set_orientation(double yaw, double pitch); //for views interpolated between simulation ticks
 	glm::mat4 get_view_matrix();
 
 private:
@@ -0,0 +1,41 @@
+#ifndef __FILE_WATCHER_H__
+#define __FILE_WATCHER_H__
+
+#include<string>
+#include<vector>
+#include<chrono>
+
+#define FILE_WATCH_POLL_MS 250 //how often the fallback compares modification times
+
+/*----- FILE WATCHER -----*/
+//Reports edits to a set of files without blocking. On Linux inotify watches each file's directory, which
+//also catches editors that save by writing a new file and renaming it over the old one; elsewhere, or when
+//inotify is unavailable, modification times are compared every FILE_WATCH_POLL_MS.
+class file_watcher {
+public:
+	file_watcher();
+	~file_watcher();
+
+	void watch(const char* file_path);
+	bool changed(); //true once for any number of edits since the last call
+	void close();
+
+private:
+	struct watched_file {
+		std::string path;
+		std::string directory;
+		std::string name;
+		int watch_descriptor;
+		long long modified; //seconds * 1e9 + nanoseconds when known, for the fallback
+		long long size;
+	};
+
+	std::vector<watched_file> files;
+	int inotify_descriptor; //-1 when polling
+	std::chrono::steady_clock::time_point last_poll;
+
+	bool read_events();
+	bool poll_times();
+};
+
+#endif // !__FILE_WATCHER_H__
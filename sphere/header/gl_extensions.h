@@ -0,0 +1,52 @@
+#ifndef __GL_EXTENSIONS_H__
+#define __GL_EXTENSIONS_H__
+
+#include<glad/glad.h>
+
+//Entry points newer than the OpenGL 3.3 core profile glad was generated for; loaded by load_gl_extensions
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+#ifndef GL_PATCHES
+#define GL_PATCHES 0x000E
+#define GL_PATCH_VERTICES 0x8E72
+#define GL_MAX_TESS_GEN_LEVEL 0x8E7E
+#define GL_TESS_EVALUATION_SHADER 0x8E87
+#define GL_TESS_CONTROL_SHADER 0x8E88
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (APIENTRYP buffer_storage_proc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+typedef void (APIENTRYP patch_parameteri_proc)(GLenum pname, GLint value);
+typedef void (APIENTRYP program_parameteri_proc)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP get_program_binary_proc)(GLuint program, GLsizei buffer_size, GLsizei* length, GLenum* binary_format, void* binary);
+typedef void (APIENTRYP program_binary_proc)(GLuint program, GLenum binary_format, const void* binary, GLsizei length);
+typedef void (APIENTRYP max_shader_compiler_threads_proc)(GLuint count);
+
+struct gl_extension_table {
+	int version; //major * 10 + minor of the current context
+	buffer_storage_proc buffer_storage; //NULL without GL 4.4 or ARB_buffer_storage
+	patch_parameteri_proc patch_parameteri; //NULL without GL 4.0 or ARB_tessellation_shader
+	program_parameteri_proc program_parameteri; //these three are NULL without GL 4.1 or ARB_get_program_binary
+	get_program_binary_proc get_program_binary;
+	program_binary_proc program_binary;
+	bool parallel_shader_compile; //KHR/ARB_parallel_shader_compile: GL_COMPLETION_STATUS_KHR can be polled
+};
+
+extern gl_extension_table gl_extensions;
+
+bool gl_has_extension(const char* name);
+//Call once after the context is current, with the same loader given to glad
+void load_gl_extensions(GLADloadproc loader);
+
+#endif // !__GL_EXTENSIONS_H__
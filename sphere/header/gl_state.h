@@ -0,0 +1,47 @@
+#ifndef __GL_STATE_H__
+#define __GL_STATE_H__
+
+#include<stddef.h>
+#include<glad/glad.h>
+
+#define GL_STATE_UNKNOWN 0xFFFFFFFFu //cached binding after invalidate(); the next bind always reaches GL
+
+//Capabilities tracked by the cache; other glEnable/glDisable targets go straight to GL
+enum gl_capability {
+	GL_STATE_DEPTH_TEST,
+	GL_STATE_CULL_FACE,
+	GL_STATE_BLEND,
+	GL_STATE_CAPABILITIES
+};
+
+/*----- GL STATE CACHE -----*/
+//Shadow of the bindings draws change most often. Every bind of a program or vertex array must go through
+//it (shader_program::use and mesh_buffer already do), otherwise the shadow goes stale and binds are lost.
+class gl_state_cache {
+public:
+	size_t issued; //GL calls made and calls dropped as redundant, since the last reset_counters
+	size_t skipped;
+
+	gl_state_cache();
+
+	void use_program(GLuint program);
+	void bind_vertex_array(GLuint VAO);
+	void set_capability(gl_capability capability, bool enabled);
+	void set_depth_write(bool enabled);
+
+	//Deleting a bound object silently changes the binding in GL, so the shadow has to forget it
+	void program_deleted(GLuint program);
+	void vertex_array_deleted(GLuint VAO);
+	void invalidate(); //after a new context or code that binds behind the cache's back
+	void reset_counters();
+
+private:
+	GLuint program;
+	GLuint VAO;
+	int capabilities[GL_STATE_CAPABILITIES]; //-1 unknown, else 0 or 1
+	int depth_write;
+};
+
+extern gl_state_cache gl_state;
+
+#endif // !__GL_STATE_H__
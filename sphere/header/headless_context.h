@@ -0,0 +1,28 @@
+#ifndef __HEADLESS_CONTEXT_H__
+#define __HEADLESS_CONTEXT_H__
+
+#include<glad/glad.h>
+
+/*----- HEADLESS CONTEXT -----*/
+//OpenGL 3.3 core context without a window, drawing into an offscreen framebuffer. Uses EGL's surfaceless
+//platform, so it runs on machines with no display or GPU (e.g. Mesa llvmpipe); unavailable on Windows.
+class headless_context {
+public:
+	int width;
+	int height;
+	GLuint FBO;
+	GLuint color_buffer;
+	GLuint depth_buffer;
+
+	headless_context();
+	~headless_context();
+
+	bool create(int width, int height); //makes the context current, loads GL and binds FBO
+	void destroy();
+
+private:
+	void* display;
+	void* context;
+};
+
+#endif // !__HEADLESS_CONTEXT_H__
@@ -0,0 +1,83 @@
+#ifndef __MESH_CACHE_H__
+#define __MESH_CACHE_H__
+
+#include<stddef.h>
+#include<stdint.h>
+#include"sphere_mesh.h"
+#include"vertex_layout.h"
+
+#define MESH_CACHE_MAGIC 0x4D485053 //"SPHM" little endian
+#define MESH_CACHE_VERSION 3 //3: vertices and triangles in optimize_sphere_mesh order
+
+/*----- MESH CACHE FILE -----*/
+/* Diagram of file
+	[mesh_cache_header][vertex bytes, laid out as the VBO][index bytes, already packed to index_type][sphere_patch array]
+	offsets are from the start of the file; checksum is FNV-1a over vertex, index and patch bytes
+*/
+struct mesh_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	int32_t level;
+	uint32_t vertex_layout; //vertex_layout_id of the vertex bytes
+	double radius;
+	uint32_t index_type; //GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	uint32_t reserved;
+	uint64_t vertex_count;
+	uint64_t index_count;
+	uint64_t vertex_offset;
+	uint64_t vertex_bytes;
+	uint64_t index_offset;
+	uint64_t index_bytes;
+	uint64_t patch_offset;
+	uint64_t patch_count; //0 when the mesh was written without patches
+	uint64_t checksum;
+};
+
+/*----- MAPPED FILE -----*/
+//Read-only memory map of a whole file
+class mapped_file {
+public:
+	const unsigned char* data;
+	size_t size;
+
+	mapped_file();
+	~mapped_file();
+
+	bool open(const char* file_path);
+	void close();
+
+private:
+#ifdef _WIN32
+	void* file_handle;
+	void* mapping_handle;
+#else
+	int file_descriptor;
+#endif
+};
+
+/*----- MESH CACHE -----*/
+//Mapped cache file; vertex_data/index_data point straight into the mapping and stay valid until close()
+class mesh_cache {
+public:
+	const mesh_cache_header* header;
+
+	mesh_cache();
+
+	//false if missing, stale, corrupt or stored with a different layout
+	bool open(const char* file_path, int level, double radius, vertex_layout_id layout = VERTEX_LAYOUT_COMPACT, bool verify_checksum = true);
+	void close();
+
+	const void* vertex_data() const;
+	const void* index_data() const;
+	const sphere_patch* patch_data() const;
+
+private:
+	mapped_file file;
+};
+
+uint64_t mesh_cache_checksum(const void* data, size_t size, uint64_t hash = 14695981039346656037ULL);
+//Writes to a temporary file and renames it into place; meshes with morph targets get the morph variant of layout
+bool write_mesh_cache(const char* file_path, const sphere_mesh& mesh, vertex_layout_id layout = VERTEX_LAYOUT_COMPACT, thread_pool* pool = NULL);
+void mesh_cache_path(char* out, size_t out_size, int level, double radius);
+
+#endif // !__MESH_CACHE_H__
@@ -0,0 +1,139 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include<stddef.h>
+#include<stdint.h>
+#include<atomic>
+#include<memory>
+#include<mutex>
+#include<string>
+#include<vector>
+#include<glad/glad.h>
+
+#define PROFILER_WINDOW 256 //latest samples per zone behind the rolling percentiles
+#define PROFILER_EVENT_CAPACITY 65536 //events each thread keeps for trace export; the oldest are overwritten
+#define PROFILER_GPU_FRAMES 4 //frames of GPU queries in flight; results are read back this many frames late
+#define PROFILER_GPU_ZONES 32 //GPU zones per frame, further ones are not timed
+
+//Building with PROFILER_DISABLED defined removes every zone; otherwise a zone costs two clock reads while enabled
+#ifndef PROFILER_DISABLED
+#define PROFILE_JOIN_NAME(a, b) a##b
+#define PROFILE_NAME(a, b) PROFILE_JOIN_NAME(a, b)
+#define PROFILE_ZONE(name) profile_zone PROFILE_NAME(profile_zone_, __LINE__)(name)
+#define PROFILE_GPU_ZONE(name) gpu_profile_zone PROFILE_NAME(gpu_profile_zone_, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_GPU_ZONE(name)
+#endif
+
+//One finished zone; times are nanoseconds since the profiler started, on the CPU clock for GPU zones too
+struct profile_event {
+	const char* name; //zone names must be string literals or otherwise outlive the profiler
+	uint64_t start;
+	uint64_t duration;
+	uint32_t depth; //zones open around it on the same thread
+};
+
+//Rolling statistics of one zone name; CPU and GPU zones with the same name are kept apart
+struct profile_stats {
+	std::string name;
+	bool gpu;
+	size_t count; //every sample since the start, the window holds the last PROFILER_WINDOW
+	double total_ms;
+	float max_ms;
+	std::vector<float> window;
+
+	float percentile(float fraction) const; //over the window
+};
+
+/*----- FRAME PROFILER -----*/
+/* Diagram of GPU query ring, PROFILER_GPU_FRAMES = 4
+	frame N:     [begin/end timestamps of each GPU zone]  <- being recorded
+	frame N - 1: in flight
+	frame N - 2: in flight
+	frame N - 3: in flight; read at begin_frame(N + 1) if available, dropped otherwise so the CPU never stalls
+*/
+//Collects CPU zones from any thread and GPU zones from the GL thread. begin_frame/end_frame on the GL thread
+//bracket each frame and fold finished events into the statistics; the raw events stay for Chrome trace export.
+class frame_profiler {
+public:
+	std::atomic<bool> enabled;
+	size_t gpu_dropped; //GPU zones whose results were not ready when their queries came round again
+
+	frame_profiler();
+
+	void begin_frame();
+	void end_frame();
+
+	void record(const char* name, uint64_t start, uint64_t end, uint32_t depth); //used by profile_zone
+	int gpu_begin(const char* name); //-1 when GPU timing is unavailable or the frame is full
+	void gpu_end(int zone);
+
+	std::vector<profile_stats> stats(); //snapshot, sorted by name
+	void print_summary();
+	//Chrome trace event format (chrome://tracing, Perfetto): one "X" event per zone, GPU zones on their own track
+	bool write_chrome_trace(const char* file_path);
+	void release(); //deletes the GL queries; call while the context is current
+
+	static uint64_t now(); //nanoseconds since the profiler started
+
+private:
+	struct thread_events {
+		uint32_t id;
+		std::mutex lock; //only contended while the GL thread drains or exports
+		std::vector<profile_event> events; //ring of PROFILER_EVENT_CAPACITY
+		uint64_t written;
+		uint64_t drained;
+	};
+	struct gpu_frame {
+		int zone_count;
+		const char* names[PROFILER_GPU_ZONES];
+		uint32_t depths[PROFILER_GPU_ZONES];
+		int64_t offset; //CPU time minus GPU time, sampled when the frame began
+	};
+
+	std::mutex threads_lock;
+	std::vector<std::unique_ptr<thread_events>> threads;
+	std::vector<profile_stats> zone_stats;
+	std::mutex stats_lock;
+	uint64_t frame_start;
+
+	int gpu_state; //0 untested, 1 available, -1 unavailable
+	GLuint queries[PROFILER_GPU_FRAMES][2 * PROFILER_GPU_ZONES];
+	gpu_frame gpu_frames[PROFILER_GPU_FRAMES];
+	uint64_t frame_index;
+	uint32_t gpu_depth;
+	thread_events gpu_events; //GPU zones already converted to the CPU clock
+
+	thread_events* local_events();
+	void append(thread_events* target, const profile_event& event);
+	void add_sample(const char* name, bool gpu, float ms);
+	void drain(thread_events* source, bool gpu);
+	void read_gpu_frame(int slot);
+};
+
+extern frame_profiler profiler;
+
+/*----- PROFILE ZONES -----*/
+//Times the enclosing scope on the calling thread; use PROFILE_ZONE("name")
+class profile_zone {
+public:
+	explicit profile_zone(const char* name);
+	~profile_zone();
+
+private:
+	const char* name;
+	uint64_t start;
+};
+
+//Times the GL commands issued in the enclosing scope with a pair of GL_TIMESTAMP queries; GL thread only
+class gpu_profile_zone {
+public:
+	explicit gpu_profile_zone(const char* name);
+	~gpu_profile_zone();
+
+private:
+	int zone;
+};
+
+#endif // !__PROFILER_H__
@@ -0,0 +1,66 @@
+#ifndef __RENDER_QUEUE_H__
+#define __RENDER_QUEUE_H__
+
+#include<stddef.h>
+#include<stdint.h>
+#include<functional>
+#include<vector>
+#include<glad/glad.h>
+
+//Fixed-function state a command needs; applied through gl_state before its program and vertex array
+enum render_flags {
+	RENDER_DEPTH_TEST = 1,
+	RENDER_DEPTH_WRITE = 2,
+	RENDER_CULL_FACE = 4
+};
+#define RENDER_OPAQUE (RENDER_DEPTH_TEST | RENDER_DEPTH_WRITE)
+
+/* Diagram of sort key, most significant bits first
+	| layer 4 | program 8 | flags 4 | vertex array 12 | material 12 | depth 24 |
+	program and vertex array are slots handed out per frame in submission order, so any GL names fit.
+	Sorting ascending groups draws by the most expensive state change first and draws each group front to back.
+*/
+#define RENDER_KEY_PROGRAMS 256
+#define RENDER_KEY_VERTEX_ARRAYS 4096
+#define RENDER_KEY_MATERIALS 4096
+
+//One recorded draw; draw() issues uniforms and the draw call with program and VAO already bound
+struct render_command {
+	GLuint program;
+	GLuint VAO; //0 when draw() binds its own
+	uint32_t flags;
+	std::function<void()> draw;
+};
+
+/*----- RENDER QUEUE -----*/
+//Per-frame command buffer. Draws are recorded in any order, radix sorted by key and submitted in one flush,
+//so state is set once per group instead of once per draw. Slot overflow only costs sort quality: each
+//command still binds its own program and vertex array.
+class render_queue {
+public:
+	float depth_range; //view distance that maps to the far end of the depth field; farther draws share it
+
+	explicit render_queue(float depth_range = 100.0f);
+
+	//material tells apart draws that share program and vertex array but set different uniforms; layers are
+	//drawn in increasing order regardless of everything else, e.g. a sky before or an overlay after the scene
+	void submit(GLuint program, GLuint VAO, uint32_t material, float depth, uint32_t flags, std::function<void()> draw, int layer = 0);
+	size_t flush(); //sorts, draws and clears; returns the number of commands drawn
+	size_t size() const;
+
+private:
+	std::vector<render_command> commands;
+	std::vector<uint64_t> keys; //parallel to commands until flush sorts them
+	std::vector<uint32_t> order; //command index of each key
+	std::vector<uint64_t> key_scratch;
+	std::vector<uint32_t> order_scratch;
+	std::vector<GLuint> program_slots; //GL name per slot, cleared every flush
+	std::vector<GLuint> vertex_array_slots;
+
+	uint32_t slot(std::vector<GLuint>* slots, GLuint name, uint32_t limit);
+};
+
+//Stable LSD radix sort on the whole 64-bit key, one byte per pass; passes where every key shares the byte are skipped
+void radix_sort_keys(uint64_t* keys, uint32_t* values, size_t count, uint64_t* key_scratch, uint32_t* value_scratch);
+
+#endif // !__RENDER_QUEUE_H__
@@ -3,27 +3,77 @@
 
 #include<stdio.h>
 #include<stdlib.h>
+#include<stdint.h>
+#include<string>
+#include<vector>
+#include<atomic>
+#include<memory>
 #include<glad/glad.h>
 #include<GLFW/glfw3.h>
 #include<glm/glm.hpp>
+#include"gl_extensions.h"
 
-const char* read_file(const char* file_path);
+const char* read_file(const char* file_path); //NULL when the file cannot be opened
+
+class thread_pool;
+
+enum shader_status {
+	SHADER_EMPTY,
+	SHADER_READING, //source files are being read on a pool thread
+	SHADER_COMPILING, //compile and link issued, the driver may still be working on them
+	SHADER_READY,
+	SHADER_FAILED //a file was missing or a stage failed; the reason has been printed, ID is left as it was
+};
+
+//Source files of a program being loaded; shared with the pool thread reading them
+struct shader_sources {
+	std::vector<std::string> paths;
+	std::vector<GLenum> types;
+	std::vector<std::string> texts;
+	bool failed;
+	std::atomic<bool> done;
+};
+
+//Active uniform found by introspection after linking; value keeps the last upload so repeats are skipped
+struct uniform_slot {
+	std::string name; //empty marks a free slot in the table
+	uint32_t hash;
+	GLint location;
+	GLenum type;
+	GLint size; //array length; arrays are always uploaded
+	bool uploaded;
+	unsigned char value[sizeof(GLdouble) * 16];
+};
 
 class shader_program {
 public:
-	GLuint ID;
+	GLuint ID; //0 until the first load is ready, then always a linked program
+	shader_status status;
+	bool from_cache; //linked program came from the program binary cache
 	
 	shader_program();
+	//Blocking; exits when a stage fails to compile or link
 	shader_program(const char* vertex_path, const char* fragment_path);
+	shader_program(const char* vertex_path, const char* tess_control_path, const char* tess_evaluation_path, const char* fragment_path); //needs GL 4.0
 
+	/*----- asynchronous loading -----*/
+	//Files are read on the pool (inline without one); compiling starts on the first poll() after that.
+	//Stages are in pipeline order. Uniform block bindings must be set again once the program is ready.
+	void load_async(const char** shader_paths, const GLenum* shader_types, int shader_count, thread_pool* pool);
+	bool poll(); //GL thread; true once status is READY or FAILED, never waits on the driver when it can avoid it
+	bool wait(); //polls until done; true when READY
+	void reload(thread_pool* pool); //starts loading the last loaded files again, for hot reload
 
 	void use();
-	
+	GLint get_location(const char* name) const; //-1 for uniforms that are inactive or live in a block
+	void bind_uniform_block(const char* name, GLuint binding); //also applied to every later reload
+
 	/*----- set primitive data -----*/
-	void set_bool(const char* name, GLboolean& value);
-	void set_int(const char* name, GLint& value);
-	void set_float(const char* name, GLfloat& value);
-	void set_double(const char* name, GLdouble &value);
+	//Setters write to the program in use and skip the GL call when the value has not changed
+	void set_bool(const char* name, GLboolean value);
+	void set_int(const char* name, GLint value);
+	void set_float(const char* name, GLfloat value);
+	void set_double(const char* name, GLdouble value);
 
 	/*----- set vectors -----*/
 	void set_vec2(const char* name, const glm::vec2 &value);
@@ -36,7 +86,26 @@ public:
 	void set_mat4(const char* name, const glm::mat4 &value);
 
 private:
-	GLuint* compile_shader(const char** shader_paths);
+	std::vector<uniform_slot> uniforms; //open addressing table, size is a power of two
+
+	std::vector<std::string> source_paths; //last load_async arguments, for reload
+	std::vector<GLenum> source_types;
+	std::vector<std::pair<std::string, GLuint>> block_bindings;
+	std::shared_ptr<shader_sources> pending;
+	std::vector<GLuint> shader_IDs; //stages of the program being linked
+	GLuint building; //program being linked; replaces ID once it succeeds
+	uint64_t cache_identity; //names the cache file
+	uint64_t cache_key; //must match the one saved in it
+
+	void build(const char** shader_paths, const GLenum* shader_types, int shader_count);
+	void start_link();
+	void finish_link();
+	void adopt();
+	void abandon();
+	void apply_block_binding(const char* name, GLuint binding);
+	void introspect_uniforms();
+	const uniform_slot* find_uniform(const char* name) const;
+	bool changed(const char* name, const void* value, size_t size, GLint* location);
 };
 
 #endif // ! __SHADER_H__
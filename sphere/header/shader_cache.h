@@ -0,0 +1,42 @@
+#ifndef __SHADER_CACHE_H__
+#define __SHADER_CACHE_H__
+
+#include<stddef.h>
+#include<stdint.h>
+#include<string>
+#include<vector>
+#include<glad/glad.h>
+
+#define SHADER_CACHE_MAGIC 0x42535053 //"SPSB" little endian
+#define SHADER_CACHE_VERSION 2
+
+/*----- SHADER CACHE FILE -----*/
+/* Diagram of file
+	[shader_cache_header][binary_bytes of glGetProgramBinary output]
+	the file name holds the program's identity, its stage paths and types, so each program has one file;
+	the key of its sources and driver sits in the header, so after an edit the new binary replaces the old one
+*/
+struct shader_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t binary_format;
+	uint32_t reserved;
+	uint64_t identity; //repeated from the file name to catch a renamed or colliding file
+	uint64_t key;
+	uint64_t binary_bytes;
+	uint64_t checksum; //FNV-1a over the binary
+};
+
+//Hash of every stage's type and source plus the driver's vendor, renderer and version strings,
+//so a driver update or any edit to a shader misses the cache instead of loading a stale binary
+uint64_t shader_cache_key(const std::vector<std::string>& sources, const std::vector<GLenum>& types);
+//Hash of every stage's type and file path; names the program's cache file
+uint64_t shader_cache_identity(const std::vector<std::string>& paths, const std::vector<GLenum>& types);
+void shader_cache_path(char* out, size_t out_size, uint64_t identity);
+
+bool program_binary_supported(); //GL 4.1 or ARB_get_program_binary, and at least one binary format
+//Loads a cached binary into program; true only when it was saved for key, the driver accepted it and the program is linked
+bool load_program_binary(GLuint program, uint64_t identity, uint64_t key);
+bool save_program_binary(GLuint program, uint64_t identity, uint64_t key); //replaces the program's previous binary
+
+#endif // !__SHADER_CACHE_H__
@@ -0,0 +1,25 @@
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include<immintrin.h>
+#endif
+
+//Functions using AVX2 must be marked so GCC/Clang emit them without a global -mavx2; MSVC needs no marking
+#if defined(SIMD_X86) && !defined(_MSC_VER)
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define SIMD_TARGET_AVX2
+#endif
+
+enum simd_level {
+	SIMD_SCALAR,
+	SIMD_SSE,
+	SIMD_AVX2
+};
+
+simd_level detect_simd_level(); //checked once, cached afterwards
+const char* simd_level_name(simd_level level);
+
+#endif // !__SIMD_H__
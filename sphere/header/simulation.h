@@ -0,0 +1,89 @@
+#ifndef __SIMULATION_H__
+#define __SIMULATION_H__
+
+#include<stdint.h>
+#include<atomic>
+#include<thread>
+#include<vector>
+#include<chrono>
+#include<glm/glm.hpp>
+#include"camera.h"
+#include"thread_pool.h"
+#include"triple_buffer.h"
+
+#define SIMULATION_HZ 120
+#define SIMULATION_MAX_CATCH_UP 8 //ticks run back to back after a stall before the backlog is dropped
+
+enum simulation_key {
+	SIMULATION_KEY_FORWARD = 1,
+	SIMULATION_KEY_BACKWARD = 2,
+	SIMULATION_KEY_LEFT = 4,
+	SIMULATION_KEY_RIGHT = 8
+};
+
+//Sampled by the render thread from GLFW; mouse totals only grow, so no motion is lost when the
+//simulation skips a sample or reads the same one twice
+struct simulation_input {
+	unsigned keys = 0; //simulation_key bits held down
+	double mouse_x = 0.0;
+	double mouse_y = 0.0;
+};
+
+//State after one tick
+struct simulation_frame {
+	uint64_t tick = 0;
+	double time = 0.0; //seconds since start() when the tick was due
+	glm::vec3 camera_position = glm::vec3(0.0f);
+	double yaw = 0.0;
+	double pitch = 0.0;
+	std::vector<glm::vec3> instance_positions;
+};
+
+//Published every tick; the render thread blends the two, so it needs both
+struct simulation_snapshot {
+	simulation_frame previous;
+	simulation_frame current;
+};
+
+/*----- SIMULATION -----*/
+/* Diagram of timing, one tick = 1 / SIMULATION_HZ
+	sim:    |tick 4|tick 5|tick 6|
+	render:            ^ now, between the publish of tick 5 and tick 6
+	shows previous + (current - previous) * (now - current.time) * SIMULATION_HZ, i.e. exactly one tick behind
+*/
+//Camera and instance motion at a fixed rate on their own thread. Input comes in and snapshots go out through
+//triple buffers, so neither thread ever blocks the other; instance motion is split across the pool.
+class simulation {
+public:
+	simulation(const camera& start_camera, const std::vector<glm::vec3>& instance_directions, float shell_radius, float spin, thread_pool* pool = NULL);
+	~simulation();
+
+	void start();
+	void stop();
+
+	void set_input(const simulation_input& input); //render thread
+	//Render thread; blends the last two ticks for the current time. False before the first tick.
+	bool sample(camera* view, std::vector<glm::vec3>* instance_positions);
+
+private:
+	typedef std::chrono::steady_clock simulation_clock;
+
+	camera state_camera;
+	std::vector<glm::vec3> directions;
+	float shell_radius;
+	float spin; //radians per second
+	thread_pool* pool;
+
+	triple_buffer<simulation_input> inputs;
+	triple_buffer<simulation_snapshot> snapshots;
+	simulation_frame last; //simulation thread's copy of the newest tick
+	simulation_input applied_input; //totals already applied to the camera
+	simulation_clock::time_point start_time;
+	std::atomic<bool> running;
+	std::thread worker;
+
+	void run();
+	void step(double time);
+};
+
+#endif // !__SIMULATION_H__
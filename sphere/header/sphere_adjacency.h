@@ -0,0 +1,53 @@
+#ifndef __SPHERE_ADJACENCY_H__
+#define __SPHERE_ADJACENCY_H__
+
+#include<stddef.h>
+#include<stdint.h>
+#include<vector>
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+
+class thread_pool;
+struct sphere_mesh;
+
+/*----- SPHERE ADJACENCY -----*/
+/* Diagram of storage (CSR)
+	offsets:   [0, 4, 10, 16, ...]            vertex_count + 1 entries
+	neighbors: [a b c d | e f g h i j | ...]  ring of v is neighbors[offsets[v] .. offsets[v + 1])
+	rings run counter-clockwise seen from outside; the 6 octahedron corners have 4 neighbors, every other vertex 6.
+	vertices are numbered ring by ring from the +y pole, so neighbors sit in the same or the adjacent rings
+*/
+struct sphere_adjacency {
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> neighbors;
+
+	size_t vertex_count() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+	uint32_t valence(uint32_t vertex) const { return offsets[vertex + 1] - offsets[vertex]; }
+	const uint32_t* ring(uint32_t vertex) const { return neighbors.data() + offsets[vertex]; }
+};
+
+//Triangle containing a direction, with weights for sampling per-vertex values there
+struct sphere_cell {
+	int face;
+	int row;
+	int column; //0 ... 2 * row, even columns upright
+	uint32_t triangle; //generation order, sphere_row_offset(face, row, n) + column
+	uint32_t vertices[3]; //lattice indices; look them up through mesh.vertex_remap on optimized meshes
+	glm::vec3 weights; //barycentric on the flat octahedron face; continuous across triangle edges
+};
+
+//Builds vertex rings from the index buffer, so it works in any triangle order (patches included)
+void build_sphere_adjacency(const std::vector<GLuint>& indices, size_t vertex_count, sphere_adjacency* adjacency, thread_pool* pool = NULL);
+//Fills mesh->adjacency
+void generate_sphere_adjacency(sphere_mesh* mesh, thread_pool* pool = NULL);
+
+//O(1) through the face/row/column parameterization; any nonzero direction works
+sphere_cell locate_sphere_cell(const glm::vec3& direction, int level);
+inline float sample_sphere_field(const sphere_cell& cell, const float* field) {
+	return cell.weights.x * field[cell.vertices[0]] + cell.weights.y * field[cell.vertices[1]] + cell.weights.z * field[cell.vertices[2]];
+}
+
+//One explicit diffusion step, out[v] = in[v] + rate * (mean of the ring - in[v]); rate in [0, 1] keeps it stable
+void diffuse_sphere_field(const sphere_adjacency& adjacency, const float* in, float* out, float rate, thread_pool* pool = NULL);
+
+#endif // !__SPHERE_ADJACENCY_H__
@@ -0,0 +1,122 @@
+#ifndef __SPHERE_CHUNKS_H__
+#define __SPHERE_CHUNKS_H__
+
+#include<stddef.h>
+#include<stdint.h>
+#include<atomic>
+#include<list>
+#include<unordered_map>
+#include<vector>
+#include<glm/glm.hpp>
+#include"sphere_mesh.h"
+#include"thread_pool.h"
+
+class shader_program;
+
+#define CHUNK_DIVISIONS 32 //triangle edges along each chunk edge; every chunk shares this topology
+#define CHUNK_MAX_DEPTH 14 //deepest quadtree level by default, lattice level CHUNK_MAX_DEPTH + 5 with 32 divisions
+#define CHUNK_DEPTH_LIMIT 28 //what a chunk_key can address
+#define CHUNK_BUDGET_BYTES (size_t(256) << 20) //GPU memory resident chunks may use before the least recently visited go
+#define CHUNK_UPLOADS_PER_FRAME 4 //finished chunks uploaded by one update(); more wait for the next frame
+#define CHUNK_TARGET_EDGE_PIXELS 8.0f
+
+/* Diagram of chunk_key bits, most significant first
+	| path 2 bits per level, level 0 lowest (56) | depth (5) | octahedron face (3) |
+	a chunk splits into its corner children 0, 1, 2 and the upside down middle child 3:
+		      a
+		     / \
+		    / 0 \
+		  ab-----ca
+		  / \ 3 / \
+		 / 1 \ / 2 \
+		b-----bc----c
+*/
+typedef uint64_t chunk_key;
+
+chunk_key make_chunk_key(int face);
+chunk_key chunk_child(chunk_key key, int child);
+int chunk_face(chunk_key key);
+int chunk_depth(chunk_key key);
+//Corners of the chunk on the flat octahedron |x| + |y| + |z| = 1, counter-clockwise seen from outside
+void chunk_corners(chunk_key key, glm::dvec3 corners[3]);
+
+//Vertices and indices of one chunk with skirts hanging below its edges to hide cracks against coarser
+//neighbors. Positions are relative to *origin, the chunk's center on the sphere, so they stay precise at depth;
+//the vertices are exactly those of lattice level chunk_depth + log2(CHUNK_DIVISIONS).
+void generate_chunk_mesh(sphere_mesh* mesh, chunk_key key, double radius, glm::dvec3* origin);
+size_t chunk_vertex_count();
+size_t chunk_index_count();
+
+struct chunk_stats {
+	size_t resident; //chunks on the GPU
+	size_t in_flight; //being generated
+	size_t drawn; //chunks drawn by the last draw()
+	uint64_t triangles; //drawn by the last draw(), skirts excluded
+	size_t resident_bytes;
+	uint64_t generated; //since creation
+	uint64_t evicted;
+};
+
+/*----- SPHERE CHUNKS -----*/
+//Sphere split into a quadtree of equal-sized chunks under each octahedron face, for levels too fine to ever
+//exist as one mesh. Each frame draw() walks the trees from the roots, splitting chunks whose triangles cover
+//more than target_edge_pixels and asking the pool for children that are not resident yet; until all visible
+//children of a chunk are in, the chunk itself is drawn. Resident chunks are kept in least recently visited
+//order and evicted past budget_bytes, never ahead of their resident children; the eight roots are never evicted.
+class sphere_chunks {
+public:
+	float target_edge_pixels;
+	size_t budget_bytes;
+
+	sphere_chunks(double radius, thread_pool* pool, int max_depth = CHUNK_MAX_DEPTH, size_t budget_bytes = CHUNK_BUDGET_BYTES);
+	~sphere_chunks();
+
+	void update(GLuint program_ID); //uploads finished chunks and evicts past the budget; GL thread only
+	bool ready() const; //every root is resident
+	//Chooses and draws chunks; frustum and eye are in model space. Sets model for each chunk on the program in use.
+	uint64_t draw(shader_program* program, const glm::mat4& model, const view_frustum& frustum, const glm::vec3& eye, float fov_y, float viewport_height);
+	chunk_stats stats() const;
+	void release();
+
+private:
+	enum chunk_state {
+		CHUNK_LOADING,
+		CHUNK_LOADED, //mesh ready on the CPU, waiting for upload
+		CHUNK_RESIDENT
+	};
+	struct chunk_entry {
+		std::atomic<int> state;
+		sphere_mesh mesh;
+		mesh_buffer buffer;
+		glm::dvec3 origin;
+		size_t bytes;
+		uint64_t last_drawn; //frame the walk last visited it, drawn or split
+		std::list<chunk_key>::iterator lru; //position in lru, roots are not in it
+	};
+
+	double radius;
+	int max_depth;
+	thread_pool* pool;
+	size_t max_in_flight;
+	size_t chunk_bytes; //GPU memory of one resident chunk; every chunk has the same topology
+	std::unordered_map<chunk_key, chunk_entry> entries; //nodes never move, so pool threads fill them in place
+	std::list<chunk_key> lru; //most recently visited first
+	std::vector<chunk_key> in_flight;
+	std::vector<chunk_entry*> visible; //chosen by the last walk
+	std::atomic<int> pending_loads;
+	uint64_t frame;
+	size_t resident_bytes;
+	uint64_t generated;
+	uint64_t evicted;
+	size_t last_drawn_count;
+	uint64_t last_triangles;
+
+	void request(chunk_key key);
+	bool resident(chunk_key key);
+	bool has_resident_children(chunk_key key);
+	void walk(chunk_key key, const glm::dvec3 corners[3], const view_frustum& frustum, const glm::vec3& eye, float pixel_scale);
+	void evict();
+	sphere_patch bounds(const glm::dvec3 corners[3]) const;
+};
+
+#endif // !__SPHERE_CHUNKS_H__
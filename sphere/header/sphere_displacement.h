@@ -0,0 +1,79 @@
+#ifndef __SPHERE_DISPLACEMENT_H__
+#define __SPHERE_DISPLACEMENT_H__
+
+#include<stddef.h>
+#include<stdint.h>
+#include<vector>
+#include<glm/glm.hpp>
+#include"sphere_kernels.h"
+
+#define DISPLACEMENT_BLOCK 256 //vertices per noise kernel call and per parallel_for chunk
+#define DISPLACEMENT_RANGE_GAP 32 //unchanged vertices worth uploading again to join two changed ranges
+
+class thread_pool;
+struct sphere_mesh;
+
+struct displacement_params {
+	noise_params noise;
+	float amplitude = 0.05f; //highest peak as a fraction of the radius
+};
+
+//Vertex slots [first, first + count)
+struct vertex_range {
+	uint32_t first;
+	uint32_t count;
+};
+
+/*----- SPHERE DISPLACEMENT -----*/
+/* Diagram of what one update touches after a patch's parameters changed
+	vertices the patch owns         new height from the noise kernel
+	  + their adjacency rings       smooth normal and morph target from the moved positions
+	patches using any of those      culling bounds
+*/
+//Moves the vertices of a sphere_mesh in place along their direction from the center to radius * (1 + amplitude * noise).
+//Each vertex follows the parameters of the first patch using it, so shared edges never crack; a mesh without patches
+//is one patch. Adjacency is built when the mesh has none. The mesh must outlive this and keep its vertex order.
+class sphere_displacement {
+public:
+	sphere_displacement(sphere_mesh* mesh, const displacement_params& params = displacement_params(), thread_pool* pool = NULL);
+
+	size_t patch_count() const;
+	const displacement_params& patch_params(size_t patch) const;
+	void set_params(const displacement_params& params); //every patch
+	void set_patch_params(size_t patch, const displacement_params& params);
+
+	//Re-evaluates only the patches changed since the last update; returns the number of vertices written
+	size_t update(thread_pool* pool = NULL);
+	//Written by the last update, for mesh_buffer::update_vertices; short gaps of unchanged vertices are included
+	const std::vector<vertex_range>& changed() const;
+
+private:
+	struct displacement_block {
+		uint32_t patch;
+		uint32_t begin; //into owned
+		uint32_t end;
+	};
+
+	sphere_mesh* mesh;
+	std::vector<glm::vec3> directions; //unit, from the undisplaced positions
+	std::vector<uint32_t> owned_offsets; //CSR of the vertices each patch displaces
+	std::vector<uint32_t> owned;
+	std::vector<uint32_t> user_offsets; //CSR of the patches using each vertex
+	std::vector<uint32_t> users;
+	std::vector<uint32_t> morph_parents; //2 per vertex; the coarse position is their midpoint, both are the vertex itself when it exists on the coarse level
+	std::vector<displacement_params> params;
+	std::vector<uint8_t> dirty; //per patch
+	std::vector<uint8_t> marks; //per vertex scratch for update
+	std::vector<uint32_t> touched;
+	std::vector<uint8_t> stale; //per patch scratch: bounds to recompute
+	std::vector<uint32_t> stale_patches;
+	std::vector<displacement_block> blocks;
+	std::vector<vertex_range> ranges;
+
+	void find_morph_parents();
+	void find_users();
+	void displace(const displacement_block& block);
+	void refresh(uint32_t vertex); //normal and morph target
+};
+
+#endif // !__SPHERE_DISPLACEMENT_H__
@@ -0,0 +1,43 @@
+#ifndef __SPHERE_IMPOSTORS_H__
+#define __SPHERE_IMPOSTORS_H__
+
+#include<stddef.h>
+#include<memory>
+#include<glad/glad.h>
+#include"shader.h"
+#include"sphere_instances.h"
+#include"streaming_buffer.h"
+
+/*----- SPHERE IMPOSTORS -----*/
+//Spheres drawn as one camera-facing quad each instead of a mesh: the fragment shader intersects the pixel's
+//ray with the analytic sphere, writing its depth and lighting it with the exact normal. Four vertices per
+//sphere at any size on screen, so millions fit where meshes would need hundreds of vertices apiece.
+//Instances reuse sphere_instance and are rewritten every frame through a streaming_buffer.
+class sphere_impostors {
+public:
+	GLuint VAO; //holds only the instance attributes; corners come from gl_VertexID
+	shader_program* program; //owned; built by create() from the impostor_*.glsl stages
+
+	sphere_impostors(size_t capacity = 4096); //initial instances; map() grows it
+	~sphere_impostors();
+
+	bool create(); //compiles the program; GL thread only, false when the shaders fail to build
+	//Room for count instances this frame, written straight into GPU visible memory; fill every one, then unmap.
+	//The pointer may be filled from any thread, map and unmap stay on the GL thread.
+	sphere_instance* map(size_t count);
+	void unmap();
+	void upload(const sphere_instance* instances, size_t count); //map, copy and unmap
+	void draw(); //the program must be in use
+	size_t size() const;
+	void release();
+
+private:
+	std::unique_ptr<streaming_buffer> stream;
+	size_t capacity;
+	size_t count;
+	size_t mapped_count;
+
+	void point_attributes(GLintptr offset);
+};
+
+#endif // !__SPHERE_IMPOSTORS_H__
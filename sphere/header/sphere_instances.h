@@ -0,0 +1,63 @@
+#ifndef __SPHERE_INSTANCES_H__
+#define __SPHERE_INSTANCES_H__
+
+#include<memory>
+#include<vector>
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include"sphere_mesh.h"
+#include"streaming_buffer.h"
+
+//Per-instance vertex data; matches iPositionRadius / iColor in basic_vertex.glsl
+struct sphere_instance {
+	glm::vec4 position_radius; //xyz center, w radius
+	glm::vec4 color; //alpha blends the instance color over the mesh's vertex colors
+};
+
+typedef GLuint instance_handle; //stable across removals of other instances
+
+#define INSTANCE_NO_SLOT GLuint(-1) //slot of a removed handle
+
+/*----- SPHERE INSTANCES -----*/
+//Dense per-instance buffer drawn with one glDrawElementsInstanced call. Instances are kept packed by
+//swapping the last one into removed slots; only the range touched since the last upload is resent.
+//Streaming instances are instead rewritten in full every upload through a streaming_buffer, for sets
+//that move every frame.
+class sphere_instances {
+public:
+	GLuint VBO; //unused when streaming
+
+	sphere_instances(size_t capacity = 1024, bool streaming = false);
+
+	instance_handle add(const glm::vec3& position, float radius, const glm::vec4& color);
+	void update(instance_handle handle, const glm::vec3& position, float radius);
+	void update_color(instance_handle handle, const glm::vec4& color);
+	void remove(instance_handle handle);
+	size_t size() const;
+
+	void attach(const mesh_buffer& mesh, GLuint program_ID); //adds instance attributes to the mesh's VAO
+	void upload(); //sends dirty instances; reallocates the buffer when it has grown
+	void draw(const mesh_buffer& mesh);
+	void release();
+
+private:
+	std::vector<sphere_instance> instances;
+	std::vector<GLuint> slots; //handle -> index in instances
+	std::vector<instance_handle> handles; //index in instances -> handle
+	std::vector<instance_handle> free_handles;
+	size_t gpu_capacity;
+	size_t dirty_begin;
+	size_t dirty_end;
+	bool streaming;
+	std::unique_ptr<streaming_buffer> stream;
+	std::vector<GLuint> attached_VAOs; //streamed attributes are re-pointed at the new region every upload
+	GLint position_location;
+	GLint color_location;
+
+	bool valid(instance_handle handle) const;
+	void mark_dirty(size_t slot);
+	void point_attributes(GLintptr offset);
+	void stream_upload();
+};
+
+#endif // !__SPHERE_INSTANCES_H__
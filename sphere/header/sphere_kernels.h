@@ -0,0 +1,36 @@
+#ifndef __SPHERE_KERNELS_H__
+#define __SPHERE_KERNELS_H__
+
+#include<stddef.h>
+#include<stdint.h>
+#include<glm/glm.hpp>
+#include"simd.h"
+
+/*----- SPHERE KERNELS -----*/
+//Projects points given as separate x, y, z arrays onto a sphere around the origin and writes
+//interleaved positions and unit normals; one reciprocal square root per vertex, AVX2/SSE picked at runtime
+void sphere_normalization(const float* x, const float* y, const float* z, size_t count, float radius, glm::vec3* positions, glm::vec3* normals);
+
+//Same projection forced onto one instruction set; used to compare paths
+void sphere_normalization(simd_level level, const float* x, const float* y, const float* z, size_t count, float radius, glm::vec3* positions, glm::vec3* normals);
+
+//Ray against a sphere around the origin for rays given as separate origin/direction component arrays;
+//writes both ray parameters of the crossings, t_near = +inf and t_far = -inf for rays that miss
+void ray_sphere_intersection(const float* const origin[3], const float* const direction[3], size_t count, float radius, float* t_near, float* t_far);
+void ray_sphere_intersection(simd_level level, const float* const origin[3], const float* const direction[3], size_t count, float radius, float* t_near, float* t_far);
+
+//Sum of gradient noise octaves; octave k samples at frequency * lacunarity^k with weight gain^k
+struct noise_params {
+	int octaves = 6;
+	float frequency = 2.0f;
+	float lacunarity = 2.0f;
+	float gain = 0.5f;
+	uint32_t seed = 0;
+};
+
+//Fractal gradient noise at points given as separate x, y, z arrays, normalized by the octave weights so it
+//stays within about [-1, 1]; lattice hashing uses only adds, shifts and xors, so SSE2 runs it without gathers
+void fractal_noise(const float* x, const float* y, const float* z, size_t count, const noise_params& params, float* out);
+void fractal_noise(simd_level level, const float* x, const float* y, const float* z, size_t count, const noise_params& params, float* out);
+
+#endif // !__SPHERE_KERNELS_H__
@@ -0,0 +1,176 @@
+#ifndef __SPHERE_LATTICE_H__
+#define __SPHERE_LATTICE_H__
+
+#include<stddef.h>
+#include<stdint.h>
+
+/*----- SPHERE LATTICE -----*/
+//Closed-form numbering of the subdivided octahedron shared by the runtime and compile-time generators.
+//A level with n divisions per edge has lattice points (x, y, z), |x| + |y| + |z| = n.
+
+//Sign of x, y and z for each octahedron face; first four are the top half
+constexpr int sphere_face_signs[8][3] = {
+	{ 1, 1, 1}, {-1, 1, 1}, {-1, 1,-1}, { 1, 1,-1},
+	{ 1,-1, 1}, {-1,-1, 1}, {-1,-1,-1}, { 1,-1,-1}
+};
+
+//Number of vertices in the ring at height y
+constexpr size_t sphere_ring_size(int y, int n) {
+	return n == (y < 0 ? -y : y) ? 1 : 4 * size_t(n - (y < 0 ? -y : y));
+}
+
+//First vertex index of the ring at height y; rings run from the +y pole to the -y pole
+constexpr size_t sphere_ring_offset(int y, int n) {
+	if (y >= 0) {
+		size_t k = n - y;
+		return k == 0 ? 0 : 1 + 2 * k * (k - 1);
+	}
+	size_t m = -y;
+	return 1 + 2 * size_t(n) * (n + 1) + 4 * (m - 1) * n - 2 * (m - 1) * m;
+}
+
+/* Diagram of vertex numbering in one ring (|x| + |z| = k, seen from +y)
+			(0,k) <- position k
+		   /     \
+	 (-k,0)       (k,0) <- position 0		positions walk the four edges in order,
+		   \     /								k positions per edge
+			(0,-k) <- position 3k
+*/
+constexpr void sphere_ring_point(int y, int n, size_t position, int* x, int* z) {
+	int k = n - (y < 0 ? -y : y);
+	int quadrant = k == 0 ? 0 : int(position / k), t = k == 0 ? 0 : int(position % k);
+	switch (quadrant) {
+	case 0: *x = k - t; *z = t; break;
+	case 1: *x = -t; *z = k - t; break;
+	case 2: *x = -(k - t); *z = -t; break;
+	default: *x = t; *z = -(k - t); break;
+	}
+}
+
+//Vertex index of lattice point (x, y, z); shared by every face touching it
+constexpr uint32_t sphere_lattice_index(int x, int y, int z, int n) {
+	int k = n - (y < 0 ? -y : y);
+	size_t position = 0;
+	if (k == 0)
+		position = 0;
+	else if (x > 0 && z >= 0)
+		position = z;
+	else if (x <= 0 && z > 0)
+		position = k - x;
+	else if (x < 0 && z <= 0)
+		position = 2 * k - z;
+	else
+		position = 3 * k + x;
+	return uint32_t(sphere_ring_offset(y, n) + position);
+}
+
+//Ends of the coarse edge that lattice point (x, y, z) of an even level splits, as points of the same level;
+//false when the point also exists on the level above. On a midpoint exactly two coordinates are odd, and the
+//coarse ends shift one unit of length between them.
+constexpr bool sphere_morph_parents(int x, int y, int z, int a[3], int b[3]) {
+	int lattice[3] = { x, y, z }, odd[2] = {}, odd_count = 0;
+	for (int i = 0; i < 3; i++) {
+		if (lattice[i] % 2 != 0 && odd_count < 2)
+			odd[odd_count++] = i;
+	}
+	if (odd_count == 0)
+		return false;
+
+	int step_0 = lattice[odd[0]] > 0 ? 1 : -1, step_1 = lattice[odd[1]] > 0 ? 1 : -1;
+	for (int i = 0; i < 3; i++)
+		a[i] = b[i] = lattice[i];
+	a[odd[0]] += step_0;
+	a[odd[1]] -= step_1;
+	b[odd[0]] -= step_0;
+	b[odd[1]] += step_1;
+	return true;
+}
+
+//First triangle of (face, row); triangle row r holds 2r + 1 triangles starting at r * r within its face
+constexpr size_t sphere_row_offset(int face, int row, int n) {
+	return size_t(face) * n * n + size_t(row) * row;
+}
+
+/* Diagram of lattice on one octahedron face (first octant, x + y + z = n)
+	 row 0        (0,0)
+				  /   \
+	 row 1     (1,0)-(1,1)
+			   /  \  /  \
+	 row 2  (2,0)-(2,1)-(2,2)	.....
+  lattice point of (row, col) is x = row - col, y = n - row, z = col
+  upright and upside down triangles alternate along a row
+*/
+//Writes the 3 * (2 * row + 1) indices of one triangle row, counter-clockwise when viewed from outside
+template<class index_t>
+constexpr void sphere_face_row(int face, int row, int n, index_t* out) {
+	int sx = sphere_face_signs[face][0], sy = sphere_face_signs[face][1], sz = sphere_face_signs[face][2];
+	bool mirrored = (sx * sy * sz) < 0; //odd number of reflections flips the winding
+
+	for (int col = 0; col <= row; col++) {
+		index_t top = index_t(sphere_lattice_index(sx * (row - col), sy * (n - row), sz * col, n));
+		index_t left = index_t(sphere_lattice_index(sx * (row + 1 - col), sy * (n - row - 1), sz * col, n));
+		index_t right = index_t(sphere_lattice_index(sx * (row - col), sy * (n - row - 1), sz * (col + 1), n));
+		*out++ = top;
+		*out++ = mirrored ? left : right;
+		*out++ = mirrored ? right : left;
+
+		if (col < row) {
+			index_t top_right = index_t(sphere_lattice_index(sx * (row - col - 1), sy * (n - row), sz * (col + 1), n));
+			*out++ = top;
+			*out++ = mirrored ? right : top_right;
+			*out++ = mirrored ? top_right : right;
+		}
+	}
+}
+
+//Lattice points of triangle column t (0 ... 2 * row) of one row, in the order sphere_face_row writes their
+//indices; even columns are upright, odd ones upside down
+constexpr void sphere_face_triangle_points(int face, int row, int t, int n, int out[3][3]) {
+	int sx = sphere_face_signs[face][0], sy = sphere_face_signs[face][1], sz = sphere_face_signs[face][2];
+	bool mirrored = (sx * sy * sz) < 0;
+	int col = t / 2;
+	int top[3] = { sx * (row - col), sy * (n - row), sz * col };
+	int right[3] = { sx * (row - col), sy * (n - row - 1), sz * (col + 1) };
+	int left[3] = { sx * (row + 1 - col), sy * (n - row - 1), sz * col };
+	int top_right[3] = { sx * (row - col - 1), sy * (n - row), sz * (col + 1) };
+	const int* second = t % 2 == 0 ? (mirrored ? left : right) : (mirrored ? right : top_right);
+	const int* third = t % 2 == 0 ? (mirrored ? right : left) : (mirrored ? top_right : right);
+
+	for (int i = 0; i < 3; i++) {
+		out[0][i] = top[i];
+		out[1][i] = second[i];
+		out[2][i] = third[i];
+	}
+}
+constexpr void sphere_face_triangle(int face, int row, int t, int n, uint32_t* out) {
+	int points[3][3] = {};
+	sphere_face_triangle_points(face, row, t, n, points);
+	for (int i = 0; i < 3; i++)
+		out[i] = sphere_lattice_index(points[i][0], points[i][1], points[i][2], n);
+}
+
+/* Diagram of locate on one face, lattice coordinates (row, col)
+	a direction scaled so |x| + |y| + |z| = n lands on the flat face at row = n - |y|, col = |z|;
+	in row r with u = row - r, the upright triangle at col c covers c <= col <= c + u,
+	the upside down one after it covers c + u <= col <= c + 1
+*/
+//Triangle column t of (face, row) whose radial projection contains direction (x, y, z); any nonzero direction
+//works. row_f and col_f, when given, receive the continuous lattice coordinates of the direction on that face.
+constexpr void sphere_lattice_locate(float x, float y, float z, int n, int* face, int* row, int* t, float* row_f = nullptr, float* col_f = nullptr) {
+	float ax = x < 0.0f ? -x : x, ay = y < 0.0f ? -y : y, az = z < 0.0f ? -z : z;
+	float scale = float(n) / (ax + ay + az);
+	float lattice_row = float(n) - ay * scale, lattice_col = az * scale;
+	int r = int(lattice_row), c = int(lattice_col);
+
+	r = r < 0 ? 0 : (r > n - 1 ? n - 1 : r);
+	c = c < 0 ? 0 : (c > r ? r : c);
+	*face = (y < 0.0f ? 4 : 0) + (z < 0.0f ? (x < 0.0f ? 2 : 3) : (x < 0.0f ? 1 : 0));
+	*row = r;
+	*t = (c == r || lattice_col - c <= lattice_row - r) ? 2 * c : 2 * c + 1;
+	if (row_f)
+		*row_f = lattice_row;
+	if (col_f)
+		*col_f = lattice_col;
+}
+
+#endif // !__SPHERE_LATTICE_H__
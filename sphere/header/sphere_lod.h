@@ -0,0 +1,71 @@
+#ifndef __SPHERE_LOD_H__
+#define __SPHERE_LOD_H__
+
+#include<atomic>
+#include<memory>
+#include<functional>
+#include<glm/glm.hpp>
+#include"sphere_mesh.h"
+#include"mesh_cache.h"
+#include"thread_pool.h"
+
+//Level picked for one frame; morph blends the level towards level - 1 (1 = looks exactly like level - 1)
+struct lod_selection {
+	int level;
+	float morph;
+};
+
+/*----- SPHERE LOD -----*/
+//Keeps a range of subdivision levels of one sphere. Levels are loaded on the pool the first time they are
+//wanted (from the mesh cache when possible), uploaded on the GL thread by update(), and chosen per frame
+//from the sphere's projected size so every triangle edge covers roughly target_edge_pixels.
+class sphere_lod {
+public:
+	typedef std::function<void(sphere_mesh*, int)> mesh_loader; //fills mesh for a level
+
+	float target_edge_pixels;
+	bool blend; //geomorph between levels; without it level changes use hysteresis instead
+
+	sphere_lod(int min_level, int max_level, double radius, thread_pool* pool, mesh_loader loader = mesh_loader());
+	~sphere_lod();
+
+	void request(int level); //starts loading a level in the background if it is not resident yet
+	void update(GLuint program_ID); //uploads at most one finished level; GL thread only
+	bool resident(int level) const;
+
+	lod_selection select(const glm::vec3& center, const glm::vec3& eye, float fov_y, float viewport_height);
+	void draw(const lod_selection& selection);
+	size_t draw(const lod_selection& selection, const view_frustum& frustum, const glm::vec3& eye); //culled; returns triangles drawn
+	size_t triangle_count(const lod_selection& selection) const;
+	GLuint vertex_array(const lod_selection& selection) const; //VAO draw() binds, 0 when nothing is resident
+	void release();
+
+private:
+	enum level_state {
+		LEVEL_EMPTY,
+		LEVEL_LOADING,
+		LEVEL_LOADED, //mesh or cache ready on the CPU, waiting for upload
+		LEVEL_RESIDENT
+	};
+	struct lod_level {
+		std::atomic<int> state;
+		sphere_mesh mesh;
+		mesh_cache cache;
+		bool from_cache;
+		mesh_buffer buffer;
+	};
+
+	int min_level;
+	int max_level;
+	double radius;
+	int current_level; //last chosen level, for hysteresis
+	thread_pool* pool;
+	mesh_loader loader;
+	std::unique_ptr<lod_level[]> levels;
+	std::atomic<int> pending_loads; //destructor waits for these, they write into levels
+
+	void load(int level); //runs on a pool thread
+	int nearest_resident(int level) const;
+};
+
+#endif // !__SPHERE_LOD_H__
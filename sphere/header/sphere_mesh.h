@@ -0,0 +1,80 @@
+#ifndef __SPHERE_MESH_H__
+#define __SPHERE_MESH_H__
+
+#include<vector>
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include"thread_pool.h"
+#include"sphere_lattice.h"
+#include"vertex_layout.h"
+#include"sphere_patches.h"
+#include"sphere_adjacency.h"
+
+/*----- SPHERE MESH -----*/
+//Subdivided octahedron projected onto a sphere; every vertex is stored once and shared through the index buffer
+struct sphere_mesh {
+	int level = 0;
+	double radius = 1.0;
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec4> colors;
+	std::vector<GLuint> indices; //3 per triangle, counter-clockwise when viewed from outside
+	std::vector<glm::vec3> morph_targets; //optional; where each vertex sits on the next coarser level
+	std::vector<sphere_patch> patches; //optional; culling ranges of indices, see build_sphere_patches
+	sphere_adjacency adjacency; //optional; vertex neighbor rings, see generate_sphere_adjacency
+	std::vector<uint32_t> vertex_remap; //optional; stored slot of each lattice vertex, see optimize_sphere_mesh
+};
+
+//Number of subdivisions along each octahedron edge for a given level (2^level)
+int sphere_divisions(int level);
+size_t sphere_vertex_count(int level);
+size_t sphere_triangle_count(int level);
+
+//Smallest index type able to address vertex_count vertices
+GLenum sphere_index_type(size_t vertex_count);
+
+//Debug color of a vertex; repeats red, green, blue by vertex index
+glm::vec4 sphere_vertex_color(size_t index);
+
+//Builds indexed octahedron sphere with shared vertices; output is identical whether or not a pool is given
+void generate_sphere_mesh(sphere_mesh* mesh, int level, double radius = 1, thread_pool* pool = NULL);
+
+//Fills morph_targets: vertices shared with level - 1 keep their position, the rest move to the midpoint
+//of the coarse edge they split, so blending towards the targets turns the mesh into level - 1 without popping
+void generate_morph_targets(sphere_mesh* mesh, thread_pool* pool = NULL);
+
+class mesh_cache;
+
+/*----- MESH BUFFER -----*/
+//GPU copy of a sphere_mesh; index buffer is packed to 16 bits when the vertex count allows it.
+//Morph targets, when present, are bound to vMorph for the vertex shader to blend with lod_morph.
+class mesh_buffer {
+public:
+	GLuint VAO;
+	GLuint VBO;
+	GLuint EBO;
+	GLsizei index_count;
+	GLenum index_type;
+	vertex_layout_id layout; //preset used by the next upload of a sphere_mesh; its morph variant is picked automatically
+	std::vector<sphere_patch> patches; //CPU copy for culling; empty if the mesh had none
+
+	mesh_buffer();
+
+	void upload(const sphere_mesh& mesh, GLuint program_ID);
+	void upload(const mesh_cache& cache, GLuint program_ID); //uploads straight from the mapped file
+	//Re-encodes vertices [first, first + count) of the mesh last uploaded and takes its patch bounds again
+	void update_vertices(const sphere_mesh& mesh, size_t first, size_t count);
+	void draw(GLenum primitive = GL_TRIANGLES); //GL_PATCHES for the tessellation path
+	size_t draw_visible(const view_frustum& frustum, const glm::vec3& eye); //culls patches, returns triangles drawn
+	void release();
+
+private:
+	std::vector<GLsizei> visible_counts; //reused every frame by draw_visible
+	std::vector<const void*> visible_offsets;
+	vertex_layout_id resident_layout; //layout of the bytes in VBO, morph variant included
+
+	void setup_attributes(const vertex_layout& vertex_format, size_t vertex_count, GLuint program_ID);
+};
+
+#endif // !__SPHERE_MESH_H__
@@ -0,0 +1,41 @@
+#ifndef __SPHERE_OPTIMIZE_H__
+#define __SPHERE_OPTIMIZE_H__
+
+#include<stddef.h>
+#include<stdint.h>
+#include<glad/glad.h>
+
+#define VERTEX_CACHE_SIZE 16 //post-transform FIFO entries assumed by the optimizer and the report
+
+class thread_pool;
+struct sphere_mesh;
+
+//Simulated FIFO post-transform cache over an index stream
+struct vertex_cache_stats {
+	size_t triangles;
+	size_t transforms; //vertex shader invocations, one per cache miss
+	size_t vertices; //distinct vertices referenced
+	double acmr; //transforms per triangle, 0.5 is the ideal for a large closed mesh
+	double atvr; //transforms per vertex, 1.0 is the ideal
+};
+
+/*----- VERTEX CACHE ORDER -----*/
+/* Diagram of Tipsify (Sander, Nehab, Barczak 2007)
+	     ___ ___
+	    \ 2 / 3 \		fan every unemitted triangle around the current vertex f, then move f to the
+	   1 \ / f / 4		emitted vertex that is still in cache and has the most triangles left;
+	  ----*---*---		with none left, fall back to the most recently used vertex that still has triangles
+	   6 / \ 5 /
+*/
+//Reorders the triangles of indices[0 .. index_count) in place; winding of each triangle is kept.
+//Linear in the number of triangles and working memory grows with the distinct vertices in the range only.
+void optimize_vertex_cache(GLuint* indices, size_t index_count, int cache_size = VERTEX_CACHE_SIZE);
+
+//Runs optimize_vertex_cache on each patch (or the whole index buffer without patches), so patch ranges
+//and their culling bounds stay valid, then renumbers vertices in order of first use so fetches stream forward.
+//Fills mesh->vertex_remap; build adjacency after this, not before.
+void optimize_sphere_mesh(sphere_mesh* mesh, thread_pool* pool = NULL);
+
+vertex_cache_stats measure_vertex_cache(const GLuint* indices, size_t index_count, int cache_size = VERTEX_CACHE_SIZE);
+
+#endif // !__SPHERE_OPTIMIZE_H__
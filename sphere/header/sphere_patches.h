@@ -0,0 +1,50 @@
+#ifndef __SPHERE_PATCHES_H__
+#define __SPHERE_PATCHES_H__
+
+#include<stddef.h>
+#include<stdint.h>
+#include<vector>
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+
+#define SPHERE_PATCH_GRID 8 //patches along each octahedron face edge, fewer on levels with less rows
+
+struct sphere_mesh;
+
+//Contiguous run of the index buffer with bounds for culling; stored as is in mesh cache files
+struct sphere_patch {
+	glm::vec3 center; //bounding sphere, covering the morph targets too
+	float radius;
+	glm::vec3 cone_axis; //every triangle normal is within the cone's half angle of this axis
+	float cone_sin;
+	float cone_cos; //negative when the normals spread too far to ever be all back facing
+	uint32_t first_index;
+	uint32_t index_count;
+	uint32_t reserved;
+};
+
+//Six planes facing inwards, in whatever space the matrix they were taken from maps out of
+struct view_frustum {
+	glm::vec4 planes[6];
+};
+
+/* Diagram of patches on one face, SPHERE_PATCH_GRID = 3
+	        /\
+	       /00\
+	      /----\
+	     /10/\11\
+	    /--/--\--\
+	   /20/ 21 \22\
+	  --------------
+	rows of triangles are cut every n / grid rows and the same number of columns
+*/
+//Reorders mesh->indices so each patch is contiguous and fills mesh->patches; call after morph targets exist
+void build_sphere_patches(sphere_mesh* mesh);
+//Recomputes the bounds of one patch after its vertices moved
+void update_patch_bounds(const sphere_mesh& mesh, sphere_patch* patch);
+
+view_frustum extract_frustum(const glm::mat4& clip_from_model);
+//eye is in the same space as the patch; false only when the patch is outside the frustum or entirely back facing
+bool patch_visible(const sphere_patch& patch, const view_frustum& frustum, const glm::vec3& eye);
+
+#endif // !__SPHERE_PATCHES_H__
@@ -0,0 +1,71 @@
+#ifndef __SPHERE_PICKING_H__
+#define __SPHERE_PICKING_H__
+
+#include<stddef.h>
+#include<stdint.h>
+#include<glm/glm.hpp>
+#include"sphere_mesh.h"
+#include"thread_pool.h"
+
+#define PICK_WALK_STEPS 8 //ray/plane refinements before marching through the shell instead
+#define PICK_EDGE_TOLERANCE 1e-5f //barycentric slack so rays through shared edges hit either triangle
+
+//direction does not need to be unit length; hit distances are in multiples of it
+struct pick_ray {
+	glm::vec3 origin;
+	glm::vec3 direction;
+};
+
+struct sphere_hit {
+	bool hit;
+	float distance; //origin + direction * distance is the hit point
+	glm::vec3 point; //world space
+	glm::vec3 normal; //world space face normal
+	glm::vec3 barycentric; //weights of the triangle's three vertices
+	int face;
+	int row;
+	int column; //0 ... 2 * row, even columns upright
+	uint32_t triangle; //sphere_row_offset(face, row, n) + column, the generation order; patch reordering does not change it
+	uint32_t vertices[3]; //mesh vertex indices
+};
+
+//Ray from the camera through a window pixel; x and y as GLFW reports the cursor, from the top left
+pick_ray screen_ray(const glm::mat4& view, const glm::mat4& projection, double x, double y, float width, float height);
+
+/*----- SPHERE PICKER -----*/
+/* Diagram of a pick
+	1. ray against the bounding sphere: a miss there is a miss (batches run this over SIMD packets)
+	2. walk: locate the triangle under the current point, test it and its neighbours, else move the point to
+	   where the ray crosses that triangle's plane; converges in two or three steps on the convex mesh
+	3. rarely, march through the shell between the bounding and inscribed spheres in quarter edge steps
+*/
+//Ray queries against an octahedron sphere without any acceleration structure to build: the face/row/column
+//lattice is an implicit hierarchy, and the triangle containing any direction is found in O(1) by locate().
+class sphere_picker {
+public:
+	//Positions come from mesh when given (it must outlive the picker), else from the closed-form lattice
+	sphere_picker(int level, double radius, const sphere_mesh* mesh = NULL);
+
+	bool pick(const pick_ray& ray, const glm::mat4& model, sphere_hit* hit) const;
+	//Many rays at once; hits[i] answers rays[i]. Runs on the pool when given.
+	void pick(const pick_ray* rays, size_t count, const glm::mat4& model, sphere_hit* hits, thread_pool* pool = NULL) const;
+
+	//Triangle whose radial projection contains direction; any nonzero direction works
+	static void locate(const glm::vec3& direction, int divisions, int* face, int* row, int* column);
+
+private:
+	int level;
+	int divisions;
+	float radius;
+	float bounding_radius; //every vertex is within it
+	float inscribed_radius; //every triangle plane is at least this far from the center
+	const sphere_mesh* mesh;
+
+	void triangle(int face, int row, int column, glm::vec3 corners[3], uint32_t indices[3]) const;
+	bool test_triangle(const glm::vec3& origin, const glm::vec3& direction, int face, int row, int column, sphere_hit* hit) const;
+	bool test_around(const glm::vec3& origin, const glm::vec3& direction, int face, int row, int column, sphere_hit* hit) const;
+	bool trace(const glm::vec3& origin, const glm::vec3& direction, float t_near, float t_far, sphere_hit* hit) const;
+	void finish(const pick_ray& ray, const glm::mat4& model, sphere_hit* hit) const;
+};
+
+#endif // !__SPHERE_PICKING_H__
@@ -0,0 +1,103 @@
+#ifndef __STATIC_SPHERE_H__
+#define __STATIC_SPHERE_H__
+
+#include<array>
+#include<type_traits>
+#include<string.h>
+#include"sphere_mesh.h"
+
+//Highest level baked into the binary; larger levels fall back to generate_sphere_mesh at runtime
+#ifndef STATIC_SPHERE_MAX_LEVEL
+#define STATIC_SPHERE_MAX_LEVEL 5
+#endif
+
+/*----- STATIC SPHERE -----*/
+//Sphere of a fixed level and integer radius evaluated entirely at compile time
+template<int Level, int Radius>
+struct static_sphere {
+	static constexpr int divisions = 1 << Level;
+	static constexpr size_t vertex_count = 4 * size_t(divisions) * divisions + 2;
+	static constexpr size_t index_count = 24 * size_t(divisions) * divisions;
+	typedef typename std::conditional<vertex_count <= 0xFFFF + 1, uint16_t, uint32_t>::type index_t;
+
+	std::array<float, vertex_count * 3> positions;
+	std::array<float, vertex_count * 3> normals;
+	std::array<index_t, index_count> indices;
+};
+
+//Newton-Raphson square root usable in constant expressions
+constexpr double static_sqrt(double value) {
+	double guess = value > 1.0 ? value : 1.0, previous = 0.0;
+	while (guess != previous) {
+		previous = guess;
+		guess = 0.5 * (guess + value / guess);
+	}
+	return guess;
+}
+
+template<int Level, int Radius>
+constexpr static_sphere<Level, Radius> make_static_sphere() {
+	typedef static_sphere<Level, Radius> sphere_t;
+	sphere_t sphere{};
+	int n = sphere_t::divisions;
+
+	for (int y = n; y >= -n; y--) {
+		size_t offset = sphere_ring_offset(y, n);
+		for (size_t p = 0; p < sphere_ring_size(y, n); p++) {
+			int x = 0, z = 0;
+			sphere_ring_point(y, n, p, &x, &z);
+			double inverse_length = 1.0 / static_sqrt(double(x) * x + double(y) * y + double(z) * z);
+			size_t slot = 3 * (offset + p);
+			sphere.normals[slot] = float(x * inverse_length);
+			sphere.normals[slot + 1] = float(y * inverse_length);
+			sphere.normals[slot + 2] = float(z * inverse_length);
+			sphere.positions[slot] = float(x * inverse_length * Radius);
+			sphere.positions[slot + 1] = float(y * inverse_length * Radius);
+			sphere.positions[slot + 2] = float(z * inverse_length * Radius);
+		}
+	}
+
+	for (int face = 0; face < 8; face++) {
+		for (int row = 0; row < n; row++)
+			sphere_face_row(face, row, n, sphere.indices.data() + 3 * sphere_row_offset(face, row, n));
+	}
+	return sphere;
+}
+
+template<int Level, int Radius>
+inline constexpr static_sphere<Level, Radius> static_sphere_data = make_static_sphere<Level, Radius>();
+
+//Fills mesh from the baked table when Level is small enough, otherwise generates it at runtime
+template<int Level, int Radius>
+void load_sphere_mesh(sphere_mesh* mesh, thread_pool* pool = NULL) {
+	if constexpr (Level <= STATIC_SPHERE_MAX_LEVEL) {
+		const static_sphere<Level, Radius>& baked = static_sphere_data<Level, Radius>;
+		mesh->level = Level;
+		mesh->radius = Radius;
+		mesh->positions.resize(baked.vertex_count);
+		mesh->normals.resize(baked.vertex_count);
+		mesh->colors.resize(baked.vertex_count);
+		memcpy((void*)mesh->positions.data(), baked.positions.data(), sizeof(baked.positions));
+		memcpy((void*)mesh->normals.data(), baked.normals.data(), sizeof(baked.normals));
+		mesh->indices.assign(baked.indices.begin(), baked.indices.end());
+		for (size_t i = 0; i < baked.vertex_count; i++)
+			mesh->colors[i] = sphere_vertex_color(i);
+	}
+	else
+		generate_sphere_mesh(mesh, Level, Radius, pool);
+}
+
+//Runtime level chosen among the baked tables, e.g. by the LOD system; Level is the recursion cursor
+template<int Radius, int Level = 0>
+void load_sphere_mesh_level(sphere_mesh* mesh, int level, thread_pool* pool = NULL) {
+	if constexpr (Level <= STATIC_SPHERE_MAX_LEVEL) {
+		if (level == Level)
+			load_sphere_mesh<Level, Radius>(mesh, pool);
+		else
+			load_sphere_mesh_level<Radius, Level + 1>(mesh, level, pool);
+	}
+	else
+		generate_sphere_mesh(mesh, level, Radius, pool);
+}
+
+#endif // !__STATIC_SPHERE_H__
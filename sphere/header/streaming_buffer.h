@@ -0,0 +1,38 @@
+#ifndef __STREAMING_BUFFER_H__
+#define __STREAMING_BUFFER_H__
+
+#include<stddef.h>
+#include<glad/glad.h>
+
+#define STREAMING_REGIONS 3 //frames the CPU may write ahead of the GPU
+
+/*----- STREAMING BUFFER -----*/
+/* Diagram of ring, STREAMING_REGIONS = 3
+	[ region 0: GPU reading frame N-2 ][ region 1: GPU reading frame N-1 ][ region 2: CPU writing frame N ]
+	each region gets a fence after the draws that read it; map() waits on that fence before handing it out again
+*/
+//Vertex data rewritten every frame. With glBufferStorage the whole ring stays persistently mapped and coherent,
+//so writes land in GPU visible memory directly; on plain GL 3.3 each map() orphans the buffer instead.
+class streaming_buffer {
+public:
+	GLuint VBO;
+	size_t region_size;
+	bool persistent;
+
+	streaming_buffer(size_t region_size, bool allow_persistent = true);
+	~streaming_buffer();
+
+	void* map(); //next region to write, at least region_size bytes
+	GLintptr unmap(); //byte offset of the region just written, for attribute pointers or draw offsets
+	void fence(); //after the draws reading the region have been issued
+	void release();
+
+private:
+	int region;
+	GLsync fences[STREAMING_REGIONS];
+	unsigned char* mapped; //start of the persistent mapping
+
+	void create();
+};
+
+#endif // !__STREAMING_BUFFER_H__
@@ -0,0 +1,36 @@
+#ifndef __TESSELLATED_SPHERE_H__
+#define __TESSELLATED_SPHERE_H__
+
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include"shader.h"
+#include"sphere_mesh.h"
+
+#define TESSELLATION_TARGET_EDGE_PIXELS 8.0f
+
+/*----- TESSELLATED SPHERE -----*/
+//Sphere subdivided on the GPU: only a coarse octahedron sphere is uploaded (level 0 is the 8 faces, 6 vertices)
+//and the tessellation stages split every face per frame, each edge as finely as its projected length asks for.
+//Needs GL 4.0; check supported() before create() and fall back to sphere_lod without it.
+class tessellated_sphere {
+public:
+	double radius;
+	int base_level;
+	float target_edge_pixels;
+	float max_level; //finest split of a base edge; create() clamps it to GL_MAX_TESS_GEN_LEVEL
+	shader_program* program; //owned; built by create() from the tess_*.glsl stages and basic_fragment.glsl
+
+	tessellated_sphere(double radius, int base_level = 0);
+	~tessellated_sphere();
+
+	static bool supported();
+	bool create(); //compiles the program and uploads the base mesh; GL thread only, false when unsupported or the shaders fail to build
+	//eye is in world space; returns the number of base triangles submitted as patches
+	size_t draw(const glm::mat4& model, const glm::vec3& eye, float fov_y, float viewport_height);
+	void release();
+
+private:
+	mesh_buffer buffer;
+};
+
+#endif // !__TESSELLATED_SPHERE_H__
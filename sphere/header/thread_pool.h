@@ -0,0 +1,34 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include<vector>
+#include<deque>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<functional>
+
+/*----- THREAD POOL -----*/
+//Fixed set of worker threads; thread_count includes the calling thread, 0 picks one per hardware thread
+class thread_pool {
+public:
+	thread_pool(unsigned thread_count = 0);
+	~thread_pool();
+
+	unsigned size() const; //threads taking part in parallel_for, caller included
+
+	void submit(std::function<void()> task); //runs inline when the pool has no workers
+	//Calls body(begin, end) over [0, count) in chunks of grain items; returns once every chunk is done
+	void parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex task_lock;
+	std::condition_variable task_ready;
+	bool stopping;
+
+	void worker_loop();
+};
+
+#endif // !__THREAD_POOL_H__
@@ -0,0 +1,50 @@
+#ifndef __TRIPLE_BUFFER_H__
+#define __TRIPLE_BUFFER_H__
+
+#include<atomic>
+#include<stdint.h>
+
+/*----- TRIPLE BUFFER -----*/
+/* Diagram of slots
+	writer fills [back] --publish()--> swaps back and middle, marks middle fresh
+	reader reads [front] <--acquire()-- swaps front and middle when middle is fresh
+	one writer and one reader never touch the same slot, and neither ever waits on the other
+*/
+//Latest value handoff between exactly one writer thread and one reader thread. Values the reader never
+//got to are overwritten; slots keep their allocations, so T may hold vectors that are refilled in place.
+template<typename T>
+class triple_buffer {
+public:
+	triple_buffer() : middle(1), back_index(0), front_index(2) {}
+
+	T& back() { return slots[back_index]; } //writer only
+	void publish() {
+		back_index = middle.exchange(uint8_t(back_index | FRESH), std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	//Reader only; true when front() changed since the last call
+	bool acquire() {
+		if (!(middle.load(std::memory_order_relaxed) & FRESH))
+			return false;
+		front_index = middle.exchange(front_index, std::memory_order_acq_rel) & INDEX_MASK;
+		return true;
+	}
+	const T& front() const { return slots[front_index]; }
+
+	//Fills every slot, before the two threads start
+	void reset(const T& value) {
+		for (int i = 0; i < 3; i++)
+			slots[i] = value;
+	}
+
+private:
+	static const uint8_t FRESH = 4;
+	static const uint8_t INDEX_MASK = 3;
+
+	T slots[3];
+	std::atomic<uint8_t> middle; //slot index plus FRESH once published and not yet acquired
+	uint8_t back_index;
+	uint8_t front_index;
+};
+
+#endif // !__TRIPLE_BUFFER_H__
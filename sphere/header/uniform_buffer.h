@@ -0,0 +1,37 @@
+#ifndef __UNIFORM_BUFFER_H__
+#define __UNIFORM_BUFFER_H__
+
+#include<vector>
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+
+#define FRAME_UNIFORM_BINDING 0
+
+//Mirror of the std140 "frame" block declared in the shaders; std140 pads each vec3 to 16 bytes
+struct frame_uniforms {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec4 light_color;
+	glm::vec4 light_pos;
+	glm::vec4 viewer_pos;
+};
+
+/*----- UNIFORM BUFFER -----*/
+//Uniform block shared by every program bound to the same binding point; the whole block is sent with
+//one glBufferSubData, and not at all when it matches the previous update
+class uniform_buffer {
+public:
+	GLuint UBO;
+	GLuint binding;
+
+	uniform_buffer(size_t size, GLuint binding);
+
+	void update(const void* data);
+	void release();
+
+private:
+	std::vector<unsigned char> shadow; //last uploaded contents
+	bool uploaded;
+};
+
+#endif // !__UNIFORM_BUFFER_H__
@@ -0,0 +1,77 @@
+#ifndef __VERTEX_LAYOUT_H__
+#define __VERTEX_LAYOUT_H__
+
+#include<stddef.h>
+#include<stdint.h>
+#include<vector>
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include"thread_pool.h"
+
+struct sphere_mesh;
+
+//Preset layouts; the id is stored in mesh cache files so the bytes can go to the GPU without re-encoding
+enum vertex_layout_id {
+	VERTEX_LAYOUT_CUSTOM = 0, //built with add(); cannot be cached
+	VERTEX_LAYOUT_PLANAR_PCN = 1, //all positions (float3), then colors (float4), then normals (float3): 40 bytes
+	VERTEX_LAYOUT_PLANAR_PCNM = 2, //as above followed by LOD morph targets (float3): 52 bytes
+	VERTEX_LAYOUT_COMPACT = 3, //interleaved half position, octahedral normal, unorm8 color: 16 bytes
+	VERTEX_LAYOUT_COMPACT_M = 4 //as above plus a half morph target: 24 bytes
+};
+
+enum vertex_attribute_source {
+	SOURCE_POSITION, //read by vPosition
+	SOURCE_NORMAL, //read by vNormal, or vNormalOct when octahedral encoded
+	SOURCE_COLOR, //read by vColor
+	SOURCE_MORPH //read by vMorph
+};
+
+enum vertex_attribute_format {
+	FORMAT_FLOAT3, //12 bytes
+	FORMAT_FLOAT4, //16 bytes
+	FORMAT_HALF4, //8 bytes; about 3 significant digits, w is 1
+	FORMAT_SNORM16x4, //8 bytes; for values in [-1, 1]
+	FORMAT_OCTAHEDRAL16, //4 bytes; unit vector folded onto an octahedron, decoded in the vertex shader
+	FORMAT_UNORM8x4 //4 bytes; for values in [0, 1]
+};
+
+struct vertex_attribute {
+	vertex_attribute_source source;
+	vertex_attribute_format format;
+	size_t offset; //within one vertex; planar layouts multiply it by the vertex count
+};
+
+/*----- VERTEX LAYOUT -----*/
+/* Diagram of layouts, for vertices 0, 1, 2 with attributes P, N, C
+	interleaved: [P0 N0 C0][P1 N1 C1][P2 N2 C2]	stride = size of one vertex
+	planar:      [P0 P1 P2][N0 N1 N2][C0 C1 C2]	stride = size of one attribute
+*/
+class vertex_layout {
+public:
+	vertex_layout_id id;
+	bool interleaved;
+	size_t vertex_size; //bytes used by one vertex across all attributes
+	std::vector<vertex_attribute> attributes;
+
+	vertex_layout(bool interleaved = true);
+
+	vertex_layout& add(vertex_attribute_source source, vertex_attribute_format format);
+	bool has(vertex_attribute_source source) const;
+	size_t buffer_size(size_t vertex_count) const;
+
+	void encode(const sphere_mesh& mesh, void* out, thread_pool* pool = NULL) const; //writes buffer_size() bytes
+	//Vertices [begin, end) laid out as a buffer of their own; planar attributes are end - begin vertices apart
+	void encode(const sphere_mesh& mesh, size_t begin, size_t end, void* out) const;
+	void setup(GLuint program_ID, size_t vertex_count) const; //glVertexAttribPointer for the bound VAO and VBO
+
+private:
+	void encode_range(const sphere_mesh& mesh, unsigned char* out, size_t begin, size_t end, size_t base, size_t span) const;
+};
+
+vertex_layout make_vertex_layout(vertex_layout_id id);
+//Same preset with or without the morph target attribute
+vertex_layout_id vertex_layout_with_morph(vertex_layout_id id, bool morph);
+
+uint16_t float_to_half(float value);
+
+#endif // !__VERTEX_LAYOUT_H__
@@ -0,0 +1,472 @@
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <glm/gtc/matrix_transform.hpp>
+#include "../header/benchmark.h"
+#include "../header/sphere_mesh.h"
+#include "../header/sphere_lod.h"
+#include "../header/sphere_optimize.h"
+#include "../header/sphere_displacement.h"
+#include "../header/sphere_adjacency.h"
+#include "../header/uniform_buffer.h"
+#include "../header/tessellated_sphere.h"
+#include "../header/sphere_chunks.h"
+#include "../header/sphere_impostors.h"
+#include "../header/profiler.h"
+#include "../header/render_queue.h"
+#include "../header/gl_state.h"
+
+#define BENCHMARK_QUERY_RING 4 //frames in flight before a timer query result is read back
+#define BENCHMARK_FOV 45.0f
+#define BENCHMARK_POLL_INTERVAL std::chrono::milliseconds(1) //between checks on meshes still generating
+#define NO_SAMPLE ((size_t)-1)
+
+typedef std::chrono::steady_clock benchmark_clock;
+
+static double elapsed_ms(benchmark_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(benchmark_clock::now() - start).count();
+}
+
+/*----- Report -----*/
+void benchmark_report::add(const char* section, int level, int index, double cpu_ms, double gpu_ms, size_t triangles) {
+	benchmark_sample sample;
+	sample.section = section;
+	sample.level = level;
+	sample.index = index;
+	sample.cpu_ms = cpu_ms;
+	sample.gpu_ms = gpu_ms;
+	sample.triangles = triangles;
+	samples.push_back(sample);
+}
+
+bool benchmark_report::write_csv(const char* file_path) const {
+	FILE* fp = fopen(file_path, "w");
+	if (fp == NULL) {
+		fprintf(stderr, "Failed to write benchmark CSV: %s\n", file_path);
+		return false;
+	}
+	fprintf(fp, "section,level,index,cpu_ms,gpu_ms,triangles\n");
+	for (size_t i = 0; i < samples.size(); i++) {
+		const benchmark_sample& sample = samples[i];
+		fprintf(fp, "%s,%d,%d,%.4f,%.4f,%zu\n", sample.section.c_str(), sample.level, sample.index, sample.cpu_ms, sample.gpu_ms, sample.triangles);
+	}
+	return fclose(fp) == 0;
+}
+
+bool benchmark_report::write_json(const char* file_path, const benchmark_options& options) const {
+	FILE* fp = fopen(file_path, "w");
+	if (fp == NULL) {
+		fprintf(stderr, "Failed to write benchmark JSON: %s\n", file_path);
+		return false;
+	}
+	fprintf(fp, "{\n\t\"options\": {\"width\": %d, \"height\": %d, \"frames\": %d, \"min_level\": %d, \"max_level\": %d, \"radius\": %g, \"threads\": %u},\n",
+		options.width, options.height, options.frames, options.min_level, options.max_level, options.radius, options.threads);
+	fprintf(fp, "\t\"renderer\": \"%s\",\n", (const char*)glGetString(GL_RENDERER));
+	fprintf(fp, "\t\"samples\": [\n");
+	for (size_t i = 0; i < samples.size(); i++) {
+		const benchmark_sample& sample = samples[i];
+		fprintf(fp, "\t\t{\"section\": \"%s\", \"level\": %d, \"index\": %d, \"cpu_ms\": %.4f, \"gpu_ms\": %.4f, \"triangles\": %zu}%s\n",
+			sample.section.c_str(), sample.level, sample.index, sample.cpu_ms, sample.gpu_ms, sample.triangles, i + 1 < samples.size() ? "," : "");
+	}
+	fprintf(fp, "\t]\n}\n");
+	return fclose(fp) == 0;
+}
+
+//Mean and worst case per section, split by level except for frames which move through levels
+void benchmark_report::print_summary() const {
+	std::vector<bool> printed(samples.size(), false);
+
+	printf("%-18s %5s %7s %10s %10s %10s %10s\n", "section", "level", "samples", "cpu mean", "cpu max", "gpu mean", "gpu max");
+	for (size_t i = 0; i < samples.size(); i++) {
+		bool by_level = samples[i].section.compare(0, 5, "frame") != 0;
+		double cpu_sum = 0.0, cpu_max = 0.0, gpu_sum = 0.0, gpu_max = 0.0;
+		int count = 0, gpu_count = 0;
+
+		if (printed[i])
+			continue;
+		for (size_t j = i; j < samples.size(); j++) {
+			const benchmark_sample& sample = samples[j];
+			if (printed[j] || sample.section != samples[i].section || (by_level && sample.level != samples[i].level))
+				continue;
+			printed[j] = true;
+			count++;
+			cpu_sum += sample.cpu_ms;
+			cpu_max = sample.cpu_ms > cpu_max ? sample.cpu_ms : cpu_max;
+			if (sample.gpu_ms >= 0.0) {
+				gpu_count++;
+				gpu_sum += sample.gpu_ms;
+				gpu_max = sample.gpu_ms > gpu_max ? sample.gpu_ms : gpu_max;
+			}
+		}
+		printf("%-18s %5s %7d %10.3f %10.3f", samples[i].section.c_str(), by_level ? std::to_string(samples[i].level).c_str() : "-", count, cpu_sum / count, cpu_max);
+		if (gpu_count)
+			printf(" %10.3f %10.3f\n", gpu_sum / gpu_count, gpu_max);
+		else
+			printf(" %10s %10s\n", "n/a", "n/a");
+	}
+}
+
+/*----- Timer queries -----*/
+static bool timer_queries_supported() {
+	GLint counter_bits = 0;
+	glGetQueryiv(GL_TIME_ELAPSED, GL_QUERY_COUNTER_BITS, &counter_bits);
+	return counter_bits > 0;
+}
+static double query_ms(GLuint query) {
+	GLuint64 nanoseconds = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+	return double(nanoseconds) / 1.0e6;
+}
+//Reads a query back even for warm-up frames so the query can be reused
+static void record_query(benchmark_report* report, size_t sample, GLuint query) {
+	double gpu_ms = query_ms(query);
+	if (sample != NO_SAMPLE)
+		report->samples[sample].gpu_ms = gpu_ms;
+}
+
+/*----- Benchmark sections -----*/
+//Each call gets a fresh mesh, so both pay for allocation and first touch; the order alternates between repeats
+static void benchmark_generation(const benchmark_options& options, thread_pool* pool, benchmark_report* report) {
+	for (int level = options.min_level; level <= options.max_level; level++) {
+		for (int repeat = 0; repeat < options.generation_repeats; repeat++) {
+			for (int run = 0; run < 2; run++) {
+				bool parallel = (run + repeat) % 2 == 1;
+				sphere_mesh mesh;
+				benchmark_clock::time_point start = benchmark_clock::now();
+				generate_sphere_mesh(&mesh, level, options.radius, parallel ? pool : NULL);
+				report->add(parallel ? "generate_parallel" : "generate", level, repeat, elapsed_ms(start), -1.0, sphere_triangle_count(level));
+			}
+		}
+	}
+}
+
+//Times optimize_sphere_mesh on patched meshes and prints the simulated post-transform cache before and after
+static void benchmark_optimization(const benchmark_options& options, thread_pool* pool, benchmark_report* report) {
+	printf("%5s %12s %12s %12s %12s\n", "level", "acmr before", "acmr after", "atvr before", "atvr after");
+	for (int level = options.min_level; level <= options.max_level; level++) {
+		sphere_mesh mesh;
+		vertex_cache_stats before, after;
+		benchmark_clock::time_point start;
+
+		generate_sphere_mesh(&mesh, level, options.radius, pool);
+		generate_morph_targets(&mesh, pool);
+		build_sphere_patches(&mesh);
+		before = measure_vertex_cache(mesh.indices.data(), mesh.indices.size());
+		start = benchmark_clock::now();
+		optimize_sphere_mesh(&mesh, pool);
+		report->add("optimize", level, 0, elapsed_ms(start), -1.0, sphere_triangle_count(level));
+		after = measure_vertex_cache(mesh.indices.data(), mesh.indices.size());
+		printf("%5d %12.3f %12.3f %12.3f %12.3f\n", level, before.acmr, after.acmr, before.atvr, after.atvr);
+	}
+}
+
+//Full displacement of a fresh mesh, then an incremental update after one patch's parameters change
+static void benchmark_displacement(const benchmark_options& options, thread_pool* pool, benchmark_report* report) {
+	for (int level = options.min_level; level <= options.max_level; level++) {
+		sphere_mesh mesh;
+		benchmark_clock::time_point start;
+
+		generate_sphere_mesh(&mesh, level, options.radius, pool);
+		generate_morph_targets(&mesh, pool);
+		build_sphere_patches(&mesh);
+		optimize_sphere_mesh(&mesh, pool);
+
+		sphere_displacement displacement(&mesh, displacement_params(), pool);
+		for (int repeat = 0; repeat < options.generation_repeats; repeat++) {
+			displacement_params params = displacement.patch_params(0);
+			params.noise.seed = uint32_t(repeat);
+			displacement.set_params(params);
+			start = benchmark_clock::now();
+			displacement.update(pool);
+			report->add("displace", level, repeat, elapsed_ms(start), -1.0, sphere_triangle_count(level));
+
+			params.amplitude *= 0.5f;
+			displacement.set_patch_params(repeat % displacement.patch_count(), params);
+			start = benchmark_clock::now();
+			displacement.update(pool);
+			report->add("displace_patch", level, repeat, elapsed_ms(start), -1.0, mesh.patches.empty() ? sphere_triangle_count(level) : mesh.patches[repeat % mesh.patches.size()].index_count / 3);
+		}
+	}
+}
+
+//Builds the vertex rings, then uses them the way a surface simulation would: a point lookup for every vertex
+//and random directions, and diffusion steps spreading a spike. Prints checks on both next to the timings:
+//a vertex must sample as itself, random directions must land inside their cell, and diffusion may only
+//average, so the spike stays within [0, 1]
+static void benchmark_adjacency(const benchmark_options& options, thread_pool* pool, benchmark_report* report) {
+	std::mt19937 random(1234u);
+	std::normal_distribution<float> gaussian(0.0f, 1.0f);
+
+	printf("%5s %14s %12s %12s %12s\n", "level", "vertex error", "min weight", "diffuse min", "diffuse max");
+	for (int level = options.min_level; level <= options.max_level; level++) {
+		sphere_mesh mesh;
+		std::vector<float> field, next;
+		benchmark_clock::time_point start;
+		size_t vertex_count, lookups = 0;
+		float vertex_error = 0.0f, min_weight = 1.0f, low = 1.0f, high = 0.0f;
+
+		generate_sphere_mesh(&mesh, level, options.radius, pool);
+		vertex_count = mesh.positions.size();
+		start = benchmark_clock::now();
+		generate_sphere_adjacency(&mesh, pool);
+		report->add("adjacency", level, 0, elapsed_ms(start), -1.0, sphere_triangle_count(level));
+
+		//height as the field: smooth, so interpolation inside a cell stays close to the vertices around it
+		field.resize(vertex_count);
+		for (size_t v = 0; v < vertex_count; v++)
+			field[v] = mesh.positions[v].y / float(options.radius);
+		start = benchmark_clock::now();
+		for (size_t v = 0; v < vertex_count; v++, lookups++)
+			vertex_error = fmaxf(vertex_error, fabsf(sample_sphere_field(locate_sphere_cell(mesh.positions[v], level), field.data()) - field[v]));
+		for (int i = 0; i < 4096; i++, lookups++) {
+			sphere_cell cell = locate_sphere_cell(glm::vec3(gaussian(random), gaussian(random), gaussian(random)), level);
+			min_weight = fminf(min_weight, fminf(cell.weights.x, fminf(cell.weights.y, cell.weights.z)));
+		}
+		report->add("locate", level, 0, elapsed_ms(start), -1.0, lookups);
+
+		field.assign(vertex_count, 0.0f);
+		next.resize(vertex_count);
+		field[0] = 1.0f;
+		start = benchmark_clock::now();
+		for (int step = 0; step < 64; step++) {
+			diffuse_sphere_field(mesh.adjacency, field.data(), next.data(), 0.5f, pool);
+			field.swap(next);
+		}
+		report->add("diffuse", level, 0, elapsed_ms(start), -1.0, sphere_triangle_count(level));
+		for (size_t v = 0; v < vertex_count; v++) {
+			low = fminf(low, field[v]);
+			high = fmaxf(high, field[v]);
+		}
+		printf("%5d %14.3g %12.3g %12.3g %12.3g%s\n", level, vertex_error, min_weight, low, high,
+			vertex_error > 1e-4f || min_weight < -1e-4f || low < 0.0f || high > 1.0f ? "  FAILED" : "");
+	}
+}
+
+//Upload includes encoding into the vertex layout; glFinish makes the CPU time cover the driver's copy too
+static void benchmark_upload(const benchmark_options& options, shader_program* program, thread_pool* pool, GLuint query, benchmark_report* report) {
+	for (int level = options.min_level; level <= options.max_level; level++) {
+		sphere_mesh mesh;
+		mesh_buffer buffer;
+		benchmark_clock::time_point start;
+		double cpu_ms;
+
+		generate_sphere_mesh(&mesh, level, options.radius, pool);
+		generate_morph_targets(&mesh, pool);
+		glFinish();
+		start = benchmark_clock::now();
+		if (query)
+			glBeginQuery(GL_TIME_ELAPSED, query);
+		buffer.upload(mesh, program->ID);
+		if (query)
+			glEndQuery(GL_TIME_ELAPSED);
+		glFinish();
+		cpu_ms = elapsed_ms(start);
+		report->add("upload", level, 0, cpu_ms, query ? query_ms(query) : -1.0, sphere_triangle_count(level));
+		buffer.release();
+	}
+}
+
+//Random spheres in a shell from 2 to 6 radii, sized like atoms next to the main sphere; fixed seed so runs compare
+static void generate_impostor_field(size_t count, float radius, std::vector<sphere_instance>* field) {
+	std::mt19937 random(1234u);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	field->resize(count);
+	for (size_t i = 0; i < count; i++) {
+		float z = 2.0f * unit(random) - 1.0f;
+		float angle = 6.2831853f * unit(random);
+		float ring = sqrtf(1.0f - z * z);
+		float distance = radius * (2.0f + 4.0f * unit(random));
+		glm::vec3 direction(ring * cosf(angle), z, ring * sinf(angle));
+		(*field)[i].position_radius = glm::vec4(direction * distance, radius * (0.002f + 0.008f * unit(random)));
+		(*field)[i].color = glm::vec4(direction * 0.5f + 0.5f, 1.0f);
+	}
+}
+
+/* Diagram of camera path
+	the eye circles the sphere twice while its distance swings from 30 radii in to 1.5 radii and back out,
+	so every LOD level is selected on the way in and again on the way out
+*/
+//With tessellated set the same path is drawn by the GPU subdivision path and recorded as frame_tessellated;
+//with chunks set it is drawn from streamed chunks, generated while the path runs, and recorded as frame_chunked;
+//with impostors set options.impostors spheres are streamed in every frame and ray cast around it, recorded as frame_impostors
+static void benchmark_frames(const benchmark_options& options, shader_program* program, thread_pool* pool, GLuint* queries, tessellated_sphere* tessellated, sphere_chunks* chunks,
+	sphere_impostors* impostors, benchmark_report* report) {
+	sphere_lod sphere(options.min_level, options.max_level, options.radius, pool);
+	uniform_buffer frame_buffer(sizeof(frame_uniforms), FRAME_UNIFORM_BINDING);
+	frame_uniforms frame;
+	glm::mat4 model(1.0f);
+	size_t pending[BENCHMARK_QUERY_RING]; //sample waiting on each query
+	float radius = float(options.radius);
+	render_queue queue(radius * 100.0f);
+	view_frustum frustum;
+	std::vector<sphere_instance> field;
+
+	//load every level up front so the frames measure drawing, not background generation;
+	//the GL thread sleeps between polls instead of spinning while the pool generates
+	for (int level = options.min_level; level <= options.max_level && !tessellated && !chunks; level++)
+		sphere.request(level);
+	for (int level = options.min_level; level <= options.max_level && !tessellated && !chunks; level++) {
+		sphere.update(program->ID);
+		while (!sphere.resident(level)) {
+			std::this_thread::sleep_for(BENCHMARK_POLL_INTERVAL);
+			sphere.update(program->ID);
+		}
+	}
+	if (chunks) {
+		chunks->update(program->ID);
+		while (!chunks->ready()) {
+			std::this_thread::sleep_for(BENCHMARK_POLL_INTERVAL);
+			chunks->update(program->ID);
+		}
+	}
+	if (impostors)
+		generate_impostor_field(size_t(options.impostors), radius, &field);
+
+	program->bind_uniform_block("frame", FRAME_UNIFORM_BINDING);
+	frame.projection = glm::perspective(glm::radians(BENCHMARK_FOV), float(options.width) / float(options.height), 0.1f, radius * 100.0f);
+	frame.light_color = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+	glClearColor(0.529f, 0.807f, 0.92f, 1.0f);
+	gl_state.set_depth_write(true);
+	glFinish();
+
+	//warm-up frames sit at the start of the path and are not recorded; first draws pay for shader and pipeline setup
+	int total_frames = options.warmup_frames + options.frames;
+	for (int i = 0; i < total_frames; i++) {
+		int measured = i - options.warmup_frames;
+		float t = options.frames > 1 && measured > 0 ? float(measured) / float(options.frames - 1) : 0.0f;
+		float distance = radius * (1.5f + 28.5f * (0.5f + 0.5f * cosf(6.2831853f * t)));
+		float angle = 12.566371f * t;
+		glm::vec3 eye(distance * cosf(angle), 0.25f * distance, distance * sinf(angle));
+		int slot = i % BENCHMARK_QUERY_RING;
+		benchmark_clock::time_point start = benchmark_clock::now();
+		lod_selection lod;
+		size_t drawn = 0;
+
+		//reading the result from BENCHMARK_QUERY_RING frames ago rarely waits
+		if (queries && i >= BENCHMARK_QUERY_RING)
+			record_query(report, pending[slot], queries[slot]);
+		if (queries)
+			glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+		profiler.begin_frame();
+
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		frame.view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		frame.light_pos = glm::vec4(eye, 1.0f);
+		frame.viewer_pos = glm::vec4(eye, 1.0f);
+		frame_buffer.update(&frame);
+		//drawn through the render queue like the interactive scene, so its overhead is part of the frame time
+		if (chunks) {
+			lod.level = 0;
+			chunks->update(program->ID);
+			frustum = extract_frustum(frame.projection * frame.view * model);
+			queue.submit(program->ID, 0, 0, distance - radius, RENDER_OPAQUE, [&]() {
+				PROFILE_GPU_ZONE("chunks");
+				program->set_float("lod_morph", 0.0f);
+				drawn = size_t(chunks->draw(program, model, frustum, eye, glm::radians(BENCHMARK_FOV), float(options.height)));
+			});
+		}
+		else if (tessellated) {
+			lod.level = tessellated->base_level;
+			queue.submit(tessellated->program->ID, 0, 0, distance - radius, RENDER_OPAQUE, [&]() {
+				PROFILE_GPU_ZONE("tessellated");
+				drawn = tessellated->draw(model, eye, glm::radians(BENCHMARK_FOV), float(options.height));
+			});
+		}
+		else {
+			lod = sphere.select(glm::vec3(0.0f), eye, glm::radians(BENCHMARK_FOV), float(options.height));
+			frustum = extract_frustum(frame.projection * frame.view * model);
+			queue.submit(program->ID, sphere.vertex_array(lod), 0, distance - radius, RENDER_OPAQUE, [&]() {
+				PROFILE_ZONE("sphere_draw");
+				PROFILE_GPU_ZONE("sphere");
+				program->set_mat4("model", model);
+				program->set_float("lod_morph", lod.morph);
+				drawn = sphere.draw(lod, frustum, eye);
+			});
+		}
+		//the whole field goes up again each frame, as a simulation would hand it over
+		if (impostors) {
+			impostors->upload(field.data(), field.size());
+			queue.submit(impostors->program->ID, impostors->VAO, 1, distance, RENDER_OPAQUE, [&]() {
+				PROFILE_GPU_ZONE("impostors");
+				impostors->program->set_int("shininess", 32);
+				impostors->program->set_float("ambient_stren", 0.1f);
+				impostors->program->set_float("specular_stren", 0.5f);
+				impostors->draw();
+			});
+		}
+		queue.flush();
+
+		if (queries)
+			glEndQuery(GL_TIME_ELAPSED);
+		glFlush();
+		profiler.end_frame();
+		pending[slot] = measured < 0 ? NO_SAMPLE : report->samples.size();
+		if (measured >= 0)
+			report->add(impostors ? "frame_impostors" : (chunks ? "frame_chunked" : (tessellated ? "frame_tessellated" : "frame")), lod.level, measured, elapsed_ms(start), -1.0,
+				drawn + 2 * field.size());
+	}
+
+	for (int i = total_frames - BENCHMARK_QUERY_RING; queries && i < total_frames; i++) {
+		if (i >= 0)
+			record_query(report, pending[i % BENCHMARK_QUERY_RING], queries[i % BENCHMARK_QUERY_RING]);
+	}
+	glFinish();
+	frame_buffer.release();
+	sphere.release();
+}
+
+bool run_benchmark(const benchmark_options& options, shader_program* program, benchmark_report* report) {
+	thread_pool pool(options.threads);
+	GLuint queries[BENCHMARK_QUERY_RING + 1]; //the last one times uploads
+	bool timed = timer_queries_supported();
+
+	printf("Benchmarking levels %d-%d on %s with %u threads%s\n", options.min_level, options.max_level,
+		(const char*)glGetString(GL_RENDERER), pool.size(), timed ? "" : " (no GPU timer queries)");
+	if (timed)
+		glGenQueries(BENCHMARK_QUERY_RING + 1, queries);
+
+	benchmark_generation(options, &pool, report);
+	benchmark_optimization(options, &pool, report);
+	benchmark_displacement(options, &pool, report);
+	benchmark_adjacency(options, &pool, report);
+	benchmark_upload(options, program, &pool, timed ? queries[BENCHMARK_QUERY_RING] : 0, report);
+	benchmark_frames(options, program, &pool, timed ? queries : NULL, NULL, NULL, NULL, report);
+	if (options.tessellation) {
+		tessellated_sphere tessellated(options.radius);
+		if (tessellated.create())
+			benchmark_frames(options, program, &pool, timed ? queries : NULL, &tessellated, NULL, NULL, report);
+		tessellated.release();
+	}
+	if (options.chunks) {
+		sphere_chunks chunks(options.radius, &pool);
+		benchmark_frames(options, program, &pool, timed ? queries : NULL, NULL, &chunks, NULL, report);
+		chunk_stats totals = chunks.stats();
+		printf("Chunks: %llu generated, %llu evicted, %zu resident in %.1f MB\n", (unsigned long long)totals.generated,
+			(unsigned long long)totals.evicted, totals.resident, double(totals.resident_bytes) / 1048576.0);
+		chunks.release();
+	}
+	if (options.impostors > 0) {
+		sphere_impostors impostors(size_t(options.impostors));
+		if (impostors.create())
+			benchmark_frames(options, program, &pool, timed ? queries : NULL, NULL, NULL, &impostors, report);
+		impostors.release();
+	}
+
+	if (timed)
+		glDeleteQueries(BENCHMARK_QUERY_RING + 1, queries);
+	report->print_summary();
+	if (options.trace_path)
+		profiler.print_summary();
+	bool traced = !options.trace_path || profiler.write_chrome_trace(options.trace_path);
+	profiler.release();
+	if (!traced)
+		return false;
+	if (options.csv_path && !report->write_csv(options.csv_path))
+		return false;
+	if (options.json_path && !report->write_json(options.json_path, options))
+		return false;
+	return true;
+}
@@ -42,6 +42,11 @@ void camera::process_mouse(double x_offest, double y_offset, bool constrain_pitc
 
 	update_camera_vectors();
 };
+void camera::set_orientation(double yaw, double pitch) {
+	this->yaw = yaw;
+	this->pitch = pitch;
+	update_camera_vectors();
+};
 void camera::update_camera_vectors() {
 	glm::vec3 new_front;
 
@@ -0,0 +1,120 @@
+#ifdef __linux__
+#include <errno.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+#include <stdio.h>
+#include <sys/stat.h>
+#include "../header/file_watcher.h"
+
+//Modification time and size; both -1 while the file is missing, e.g. half way through an editor's save
+static void file_stamp(const char* file_path, long long* modified, long long* size) {
+#ifdef _WIN32
+	struct _stat64 info;
+	if (_stat64(file_path, &info) != 0) {
+#else
+	struct stat info;
+	if (stat(file_path, &info) != 0) {
+#endif
+		*modified = *size = -1;
+		return;
+	}
+#if defined(__linux__)
+	*modified = (long long)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+#else
+	*modified = (long long)info.st_mtime * 1000000000LL;
+#endif
+	*size = (long long)info.st_size;
+}
+
+file_watcher::file_watcher() : inotify_descriptor(-1), last_poll(std::chrono::steady_clock::now()) {
+#ifdef __linux__
+	inotify_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_descriptor < 0)
+		fprintf(stderr, "inotify unavailable, polling watched files every %d ms\n", FILE_WATCH_POLL_MS);
+#endif
+}
+file_watcher::~file_watcher() {
+	close();
+}
+
+void file_watcher::watch(const char* file_path) {
+	watched_file file;
+	std::string path(file_path);
+	size_t slash = path.find_last_of("/\\");
+
+	file.path = path;
+	file.directory = slash == std::string::npos ? "." : path.substr(0, slash);
+	file.name = slash == std::string::npos ? path : path.substr(slash + 1);
+	file.watch_descriptor = -1;
+	file_stamp(file_path, &file.modified, &file.size);
+#ifdef __linux__
+	//files in one directory share its watch; inotify hands back the same descriptor for it
+	if (inotify_descriptor >= 0) {
+		file.watch_descriptor = inotify_add_watch(inotify_descriptor, file.directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (file.watch_descriptor < 0)
+			fprintf(stderr, "Failed to watch %s, polling it instead\n", file.directory.c_str());
+	}
+#endif
+	files.push_back(file);
+}
+
+bool file_watcher::changed() {
+	bool any = read_events();
+	return poll_times() || any;
+}
+
+//Drains every queued event; names are matched against the files watched in that directory
+bool file_watcher::read_events() {
+	bool any = false;
+#ifdef __linux__
+	alignas(struct inotify_event) char buffer[4096];
+	ssize_t length;
+
+	if (inotify_descriptor < 0)
+		return false;
+	while ((length = read(inotify_descriptor, buffer, sizeof(buffer))) > 0) {
+		for (char* at = buffer; at < buffer + length;) {
+			const struct inotify_event* event = (const struct inotify_event*)at;
+			for (size_t i = 0; i < files.size() && event->len; i++) {
+				if (files[i].watch_descriptor == event->wd && files[i].name == event->name)
+					any = true;
+			}
+			at += sizeof(struct inotify_event) + event->len;
+		}
+	}
+#endif
+	return any;
+}
+
+//Fallback for files without an inotify watch
+bool file_watcher::poll_times() {
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	bool any = false;
+
+	if (now - last_poll < std::chrono::milliseconds(FILE_WATCH_POLL_MS))
+		return false;
+	last_poll = now;
+	for (size_t i = 0; i < files.size(); i++) {
+		long long modified, size;
+		if (files[i].watch_descriptor >= 0)
+			continue;
+		file_stamp(files[i].path.c_str(), &modified, &size);
+		//a missing file is mid save; wait for it to come back rather than reloading a half written one
+		if (modified < 0 || (modified == files[i].modified && size == files[i].size))
+			continue;
+		files[i].modified = modified;
+		files[i].size = size;
+		any = true;
+	}
+	return any;
+}
+
+void file_watcher::close() {
+#ifdef __linux__
+	if (inotify_descriptor >= 0)
+		::close(inotify_descriptor);
+#endif
+	inotify_descriptor = -1;
+	files.clear();
+}
@@ -0,0 +1,49 @@
+#include <string.h>
+#include "../header/gl_extensions.h"
+
+gl_extension_table gl_extensions = {};
+
+bool gl_has_extension(const char* name) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; i++) {
+		if (!strcmp((const char*)glGetStringi(GL_EXTENSIONS, GLuint(i)), name))
+			return true;
+	}
+	return false;
+}
+
+void load_gl_extensions(GLADloadproc loader) {
+	GLint major = 0, minor = 0;
+
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	gl_extensions.version = major * 10 + minor;
+
+	//a loader can hand back a pointer for functions the driver does not actually support, so check first
+	gl_extensions.buffer_storage = NULL;
+	if (gl_extensions.version >= 44 || gl_has_extension("GL_ARB_buffer_storage"))
+		gl_extensions.buffer_storage = (buffer_storage_proc)loader("glBufferStorage");
+	gl_extensions.patch_parameteri = NULL;
+	if (gl_extensions.version >= 40 || gl_has_extension("GL_ARB_tessellation_shader"))
+		gl_extensions.patch_parameteri = (patch_parameteri_proc)loader("glPatchParameteri");
+
+	gl_extensions.program_parameteri = NULL;
+	gl_extensions.get_program_binary = NULL;
+	gl_extensions.program_binary = NULL;
+	if (gl_extensions.version >= 41 || gl_has_extension("GL_ARB_get_program_binary")) {
+		gl_extensions.program_parameteri = (program_parameteri_proc)loader("glProgramParameteri");
+		gl_extensions.get_program_binary = (get_program_binary_proc)loader("glGetProgramBinary");
+		gl_extensions.program_binary = (program_binary_proc)loader("glProgramBinary");
+	}
+
+	//the driver then compiles and links on its own threads, and glGetProgramiv can ask whether it is done yet
+	max_shader_compiler_threads_proc max_threads = NULL;
+	if (gl_has_extension("GL_KHR_parallel_shader_compile"))
+		max_threads = (max_shader_compiler_threads_proc)loader("glMaxShaderCompilerThreadsKHR");
+	else if (gl_has_extension("GL_ARB_parallel_shader_compile"))
+		max_threads = (max_shader_compiler_threads_proc)loader("glMaxShaderCompilerThreadsARB");
+	gl_extensions.parallel_shader_compile = max_threads != NULL;
+	if (max_threads)
+		max_threads(0xFFFFFFFFu); //as many as the implementation likes
+}
@@ -0,0 +1,77 @@
+#include "../header/gl_state.h"
+
+gl_state_cache gl_state;
+
+static const GLenum capability_enums[GL_STATE_CAPABILITIES] = { GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND };
+
+gl_state_cache::gl_state_cache() {
+	invalidate();
+	reset_counters();
+}
+
+void gl_state_cache::use_program(GLuint program) {
+	if (program == this->program) {
+		skipped++;
+		return;
+	}
+	glUseProgram(program);
+	this->program = program;
+	issued++;
+}
+
+void gl_state_cache::bind_vertex_array(GLuint VAO) {
+	if (VAO == this->VAO) {
+		skipped++;
+		return;
+	}
+	glBindVertexArray(VAO);
+	this->VAO = VAO;
+	issued++;
+}
+
+void gl_state_cache::set_capability(gl_capability capability, bool enabled) {
+	if (capabilities[capability] == int(enabled)) {
+		skipped++;
+		return;
+	}
+	if (enabled)
+		glEnable(capability_enums[capability]);
+	else
+		glDisable(capability_enums[capability]);
+	capabilities[capability] = int(enabled);
+	issued++;
+}
+
+void gl_state_cache::set_depth_write(bool enabled) {
+	if (depth_write == int(enabled)) {
+		skipped++;
+		return;
+	}
+	glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+	depth_write = int(enabled);
+	issued++;
+}
+
+//A deleted program stays in use until another is bound, but its name may be handed out again afterwards
+void gl_state_cache::program_deleted(GLuint program) {
+	if (program == this->program)
+		this->program = GL_STATE_UNKNOWN;
+}
+//Deleting the bound vertex array reverts the binding to 0
+void gl_state_cache::vertex_array_deleted(GLuint VAO) {
+	if (VAO == this->VAO)
+		this->VAO = 0;
+}
+
+void gl_state_cache::invalidate() {
+	program = GL_STATE_UNKNOWN;
+	VAO = GL_STATE_UNKNOWN;
+	for (int i = 0; i < GL_STATE_CAPABILITIES; i++)
+		capabilities[i] = -1;
+	depth_write = -1;
+}
+
+void gl_state_cache::reset_counters() {
+	issued = 0;
+	skipped = 0;
+}
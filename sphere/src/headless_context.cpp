@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include "../header/headless_context.h"
+#include "../header/gl_extensions.h"
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+headless_context::headless_context() : width(0), height(0), FBO(0), color_buffer(0), depth_buffer(0), display(NULL), context(NULL) {}
+headless_context::~headless_context() {
+	destroy();
+}
+
+#ifdef __linux__
+bool headless_context::create(int width, int height) {
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display;
+	EGLDisplay egl_display;
+	EGLContext egl_context;
+	EGLint context_attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	//surfaceless needs no X server or DRM device; fall back to the default display if it is missing
+	get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	egl_display = get_platform_display ? get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL) : EGL_NO_DISPLAY;
+	if (egl_display == EGL_NO_DISPLAY)
+		egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (egl_display == EGL_NO_DISPLAY || !eglInitialize(egl_display, NULL, NULL)) {
+		fprintf(stderr, "Failed to initialize EGL display (error 0x%x)\n", eglGetError());
+		return false;
+	}
+	display = egl_display;
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		fprintf(stderr, "EGL display does not support desktop OpenGL\n");
+		destroy();
+		return false;
+	}
+
+	egl_context = eglCreateContext(egl_display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, context_attributes);
+	if (egl_context == EGL_NO_CONTEXT) {
+		fprintf(stderr, "Failed to create OpenGL 3.3 core context (error 0x%x)\n", eglGetError());
+		destroy();
+		return false;
+	}
+	context = egl_context;
+	if (!eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context)) {
+		fprintf(stderr, "Failed to make headless context current (error 0x%x)\n", eglGetError());
+		destroy();
+		return false;
+	}
+	if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+		fprintf(stderr, "Failed to load GLAD\n");
+		destroy();
+		return false;
+	}
+	load_gl_extensions((GLADloadproc)eglGetProcAddress);
+
+	//with no surface there is no default framebuffer, so everything is drawn into this one
+	this->width = width;
+	this->height = height;
+	glGenFramebuffers(1, &FBO);
+	glGenRenderbuffers(1, &color_buffer);
+	glGenRenderbuffers(1, &depth_buffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glBindRenderbuffer(GL_RENDERBUFFER, color_buffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_buffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_buffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "Offscreen framebuffer is incomplete\n");
+		destroy();
+		return false;
+	}
+	glViewport(0, 0, width, height);
+	return true;
+}
+
+void headless_context::destroy() {
+	if (context) {
+		if (FBO) {
+			glDeleteRenderbuffers(1, &depth_buffer);
+			glDeleteRenderbuffers(1, &color_buffer);
+			glDeleteFramebuffers(1, &FBO);
+		}
+		eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+	}
+	if (display)
+		eglTerminate((EGLDisplay)display);
+	FBO = color_buffer = depth_buffer = 0;
+	display = context = NULL;
+}
+#else
+bool headless_context::create(int width, int height) {
+	fprintf(stderr, "Headless mode needs EGL and is only available on Linux\n");
+	return false;
+}
+void headless_context::destroy() {}
+#endif
@@ -1,52 +1,89 @@
 #include <iostream>
 #include <vector>
-#include <queue>
-#include <list>
+#include <string.h>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/gtc/type_ptr.hpp>
 #include "../header/shader.h"
 #include "../header/camera.h"
+#include "../header/sphere_mesh.h"
+#include "../header/static_sphere.h"
+#include "../header/sphere_lod.h"
+#include "../header/sphere_instances.h"
+#include "../header/sphere_impostors.h"
+#include "../header/uniform_buffer.h"
+#include "../header/headless_context.h"
+#include "../header/benchmark.h"
+#include "../header/gl_extensions.h"
+#include "../header/tessellated_sphere.h"
+#include "../header/file_watcher.h"
+#include "../header/simulation.h"
+#include "../header/sphere_picking.h"
+#include "../header/profiler.h"
+#include "../header/render_queue.h"
+#include "../header/sphere_chunks.h"
+#include "../header/gl_state.h"
 
 #define WINDOW_WIDTH 600
 #define	WINDOW_HEIGHT 800
+#define SPHERE_MIN_LEVEL 1 //coarsest LOD level, drawn when the sphere is far away
+#define SPHERE_LEVEL 7 //finest LOD level; levels up to STATIC_SPHERE_MAX_LEVEL are baked at compile time
+#define SPHERE_RADIUS 10
+#define GENERATION_THREADS 0 //0 uses every hardware thread
+#define INSTANCE_COUNT 2000 //small spheres drawn around the main one with a single instanced call
+#define INSTANCE_LEVEL 3
+#define INSTANCE_SHELL_RADIUS 30.0f
+#define INSTANCE_SPIN 0.2f //radians per second the shell turns; the simulation moves it, instances are streamed every frame
+#define PROFILE_TRACE_PATH "sphere_trace.json"
+#define MATERIAL_SPHERE 0 //render_queue materials: uniform sets the scene's draws differ by
+#define MATERIAL_INSTANCES 1
 
 
 //Callback functions for viewport, mouse, and keyboard
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void keyboard_input_callback(GLFWwindow* window, int key, int scancode, int action, int mod);
 void mouse_input_callback(GLFWwindow* window, double x_pos, double y_pos);
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mod);
 void process_input(GLFWwindow* window);
 
-//Triangle creation
-void create_equalaterial_triangle(std::vector<glm::vec3>* buffer, glm::vec3 position, double side_len); //creates a single equalaterial triangle
-void recursive_equalaterial(std::vector<glm::vec3>* buffer, int iteration); //breaks down a equalaterial triangle down into smaller equalaterial triangle
-void rotate_triangle(std::vector<glm::vec3>* buffer); //rotates triangle to create octahedron
-void sphere_normalization(std::vector<glm::vec3>* buffer, double radius = 1, glm::vec3 origin = glm::vec3(0.0f ,0.0f,0.0f)); //adjust vertices of octahedron to become a sphere
+//Input handed to the simulation thread, which owns the camera's motion
+simulation_input input_state;
 
-//FPS variables
-float delta_time = 0.0f;
-float last_frame = 0.0f;
-
-//Camera movement variables
+//Camera movement variables; main_camera is the view interpolated for the frame being drawn
 camera main_camera(glm::vec3(0.5f, 0.0f, 0.5f), glm::vec3(0.0f, 0.0f, -1.0f));
 bool first_mouse = true;
 double last_x = WINDOW_WIDTH / 2.0f;
 double last_y = WINDOW_HEIGHT / 2.0f;
 
 shader_program* program;
-
-//Calculated vertices structure for recursive triangle breakdown
-struct calculated_vertex {
-	glm::vec3 left;
-	glm::vec3 right;
-};
-calculated_vertex* create_calculated_pair(glm::vec3 left, glm::vec3 right);
+bool tessellation_mode = false; //T switches the main sphere between sphere_lod and GPU tessellation
+bool chunk_mode = false; //C switches the main sphere to streamed chunks, which keep refining far past SPHERE_LEVEL
+bool impostor_mode = false; //I draws the instance shell as ray-cast impostors instead of meshes
+bool pick_requested = false; //left click picks the triangle under the screen center, where the cursor is held
+bool profile_requested = false; //P prints the zone statistics and writes PROFILE_TRACE_PATH
 
 //Debugging functions
 void print_vector3(glm::vec3& vector);
 
-int main() {
+//Command line
+bool parse_arguments(int argc, char** argv, bool* headless, benchmark_options* options);
+int run_headless(const benchmark_options& options);
+
+int main(int argc, char** argv) {
+	bool headless = false;
+	benchmark_options options;
+
+	options.width = WINDOW_WIDTH;
+	options.height = WINDOW_HEIGHT;
+	options.min_level = SPHERE_MIN_LEVEL;
+	options.max_level = SPHERE_LEVEL;
+	options.radius = SPHERE_RADIUS;
+	options.threads = GENERATION_THREADS;
+	if (!parse_arguments(argc, argv, &headless, &options))
+		return 1;
+	if (headless)
+		return run_headless(options);
+
 	glfwInit();
 	std::cout << "OpenGL version supported: " << glfwGetVersionString() << std::endl;
 
@@ -67,101 +104,212 @@ int main() {
 		glfwTerminate();
 		return 1;
 	}
+	load_gl_extensions((GLADloadproc)glfwGetProcAddress);
 	
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 	glfwSetKeyCallback(window, keyboard_input_callback);
 	glfwSetCursorPosCallback(window, mouse_input_callback);
+	glfwSetMouseButtonCallback(window, mouse_button_callback);
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-	//setup shaders
+	//setup shaders; they load in the background while the CPU side of the scene is built
+	thread_pool generation_pool(GENERATION_THREADS);
 	const char* shader_paths[2] = { "src/shader/basic_vertex.glsl", "src/shader/basic_fragment.glsl" };
-	program = new shader_program(shader_paths[0], shader_paths[1]);
-
-	//setup equalaterial triangle
-	GLuint VAO, VBO;
-	GLuint vertex_position, vertex_normal, vertex_color;
-	glm::vec3 u, v, normal;
-	std::vector<glm::vec3> sphere_position_buffer;
-	std::vector<glm::vec4> sphere_color_buffer;
-	std::vector<glm::vec3> sphere_normal_buffer;
-	double vertex_size = sizeof(glm::vec3) * 2 + sizeof(glm::vec4);
-	int buffer_size;
-
-	create_equalaterial_triangle(&sphere_position_buffer, glm::vec3(0.0f, 0.0f, 0.0f), 2);
-	u = sphere_position_buffer[1] - sphere_position_buffer[0];
-	v = sphere_position_buffer[2] - sphere_position_buffer[0];
-	normal = glm::cross(u, v);
-	recursive_equalaterial(&sphere_position_buffer, 5);
-	rotate_triangle(&sphere_position_buffer);
-	sphere_normalization(&sphere_position_buffer, 10);
-	for (int i = 0; i < sphere_position_buffer.size(); i++) {
-		if (i % 3 == 0)
-			sphere_color_buffer.push_back(glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
-		else if (i % 3 == 1)
-			sphere_color_buffer.push_back(glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
-		else
-			sphere_color_buffer.push_back(glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
-		sphere_normal_buffer.push_back(normal);
+	const GLenum shader_types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	program = new shader_program();
+	program->load_async(shader_paths, shader_types, 2, &generation_pool);
+	//editing any of these reloads the programs; the old ones keep drawing until the new ones link
+	const char* watched_shaders[7] = { shader_paths[0], shader_paths[1], "src/shader/tess_vertex.glsl", "src/shader/tess_control.glsl", "src/shader/tess_evaluation.glsl",
+		"src/shader/impostor_vertex.glsl", "src/shader/impostor_fragment.glsl" };
+	file_watcher shader_watcher;
+	for (int i = 0; i < 7; i++)
+		shader_watcher.watch(watched_shaders[i]);
+	uniform_buffer frame_buffer(sizeof(frame_uniforms), FRAME_UNIFORM_BINDING);
+	frame_uniforms frame;
+
+	//setup sphere; levels are loaded in the background as the camera asks for them
+	sphere_lod sphere(SPHERE_MIN_LEVEL, SPHERE_LEVEL, SPHERE_RADIUS, &generation_pool, [&generation_pool](sphere_mesh* mesh, int level) {
+		load_sphere_mesh_level<SPHERE_RADIUS>(mesh, level, &generation_pool);
+	});
+	lod_selection lod;
+	glm::vec3 eye_model;
+	sphere_picker picker(SPHERE_LEVEL, SPHERE_RADIUS); //finest level, from the closed-form lattice
+	sphere_hit hit;
+	sphere_chunks chunks(SPHERE_RADIUS, &generation_pool);
+	tessellated_sphere tessellated(SPHERE_RADIUS);
+	bool tessellation_ready = tessellated_sphere::supported() && tessellated.create();
+
+	//setup instanced spheres, spread evenly over a shell with a golden angle spiral
+	sphere_mesh instance_mesh;
+	mesh_buffer instance_buffer;
+	sphere_instances instances(INSTANCE_COUNT, true);
+	std::vector<instance_handle> instance_handles;
+	std::vector<glm::vec3> instance_directions;
+	sphere_impostors impostors(INSTANCE_COUNT);
+	bool impostors_ready = impostors.create();
+	load_sphere_mesh<INSTANCE_LEVEL, 1>(&instance_mesh);
+	if (!program->wait()) {
+		glfwTerminate();
+		return 1;
 	}
-	buffer_size = sphere_position_buffer.size();
-
-	//generate equalaterial triangle
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-	vertex_position = glGetAttribLocation(program->ID, "vPosition");
-	vertex_normal = glGetAttribLocation(program->ID, "vNormal");
-	vertex_color = glGetAttribLocation(program->ID, "vColor");
-	glBufferData(GL_ARRAY_BUFFER, buffer_size * vertex_size, NULL, GL_STATIC_DRAW);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, buffer_size * sizeof(glm::vec3), (void*)sphere_position_buffer.data());
-	glBufferSubData(GL_ARRAY_BUFFER, buffer_size * sizeof(glm::vec3), buffer_size * sizeof(glm::vec4), (void*)sphere_color_buffer.data());
-	glBufferSubData(GL_ARRAY_BUFFER, buffer_size * (sizeof(glm::vec3) + sizeof(glm::vec4)), buffer_size * sizeof(glm::vec3), (void*)sphere_normal_buffer.data());
-
-	glVertexAttribPointer(vertex_position, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
-	glVertexAttribPointer(vertex_color, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)(buffer_size * sizeof(glm::vec3)));
-	glVertexAttribPointer(vertex_normal, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)(buffer_size * (sizeof(glm::vec3) + sizeof(glm::vec4))));
-
-	glEnableVertexAttribArray(vertex_position);
-	glEnableVertexAttribArray(vertex_color);
-	glEnableVertexAttribArray(vertex_normal);
-
-	float current_frame;
+	program->bind_uniform_block("frame", FRAME_UNIFORM_BINDING);
+	instance_buffer.upload(instance_mesh, program->ID);
+	instances.attach(instance_buffer, program->ID);
+	for (int i = 0; i < INSTANCE_COUNT; i++) {
+		float y = 1.0f - 2.0f * (i + 0.5f) / INSTANCE_COUNT, ring = sqrtf(1.0f - y * y), angle = 2.39996323f * i;
+		glm::vec3 direction(ring * cosf(angle), y, ring * sinf(angle));
+		instance_handles.push_back(instances.add(direction * INSTANCE_SHELL_RADIUS, 0.4f, glm::vec4(direction * 0.5f + 0.5f, 1.0f)));
+		instance_directions.push_back(direction);
+	}
+
+	//camera and instance motion run at a fixed tick on their own thread from here on
+	simulation world(main_camera, instance_directions, INSTANCE_SHELL_RADIUS, INSTANCE_SPIN, &generation_pool);
+	std::vector<glm::vec3> instance_positions;
+	world.start();
+
 	glm::mat4 model(1.0f);
 	glm::mat4 projection = glm::perspective(glm::radians(main_camera.zoom), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f);
 	int shininess = 32;
 	float ambient_str = 0.1f, specular_str = 0.5f;
+	render_queue queue(100.0f); //depth range matches the far plane
+	view_frustum frustum;
+	float sphere_depth;
 	glClearColor(0.529f, 0.807f, 0.92f, 1.0f);
 	while (!glfwWindowShouldClose(window)) {
+		profiler.begin_frame();
+		gl_state.set_depth_write(true); //glClear honours the depth mask the last command left behind
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glEnable(GL_DEPTH_TEST);
 
-		//Update frames
-		current_frame = glfwGetTime();
-		delta_time = current_frame - last_frame;
-		last_frame = current_frame;
+		//Hand over input, then take the view and instances blended for this moment
 		process_input(window);
+		world.set_input(input_state);
+		world.sample(&main_camera, &instance_positions);
+
+		{
+			PROFILE_ZONE("shader_poll");
+			if (shader_watcher.changed()) {
+				program->reload(&generation_pool);
+				if (tessellation_ready)
+					tessellated.program->reload(&generation_pool);
+				if (impostors_ready)
+					impostors.program->reload(&generation_pool);
+			}
+			program->poll();
+			if (tessellation_ready)
+				tessellated.program->poll();
+			if (impostors_ready)
+				impostors.program->poll();
+		}
+
+		//Set uniforms; per-frame values go out in one block, the rest only when they change
+		frame.view = main_camera.get_view_matrix();
+		frame.projection = projection;
+		frame.light_color = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+		frame.light_pos = glm::vec4(main_camera.position, 1.0f);
+		frame.viewer_pos = glm::vec4(main_camera.position, 1.0f);
+		frame_buffer.update(&frame);
 
-		//Set uniforms
+		program->use();
 		program->set_mat4("model", model);
-		program->set_mat4("view", main_camera.get_view_matrix());
-		program->set_mat4("projection", projection);
-		program->set_vec3("light_color", glm::vec3(1.0f, 1.0f, 1.0f));
-		program->set_vec3("light_pos", main_camera.position);
-		program->set_vec3("viewer_pos", main_camera.position);
 		program->set_int("shininess", shininess);
 		program->set_float("ambient_stren", ambient_str);
 		program->set_float("specular_stren", specular_str);
 
-		glUseProgram(program->ID);
-		glBindVertexArray(VAO);
-		glDrawArrays(GL_TRIANGLES, 0, buffer_size);
+		//Record the draws; the queue sorts them by state and draws nearest first within each state
+		sphere.update(program->ID);
+		chunks.update(program->ID);
+		sphere_depth = glm::length(main_camera.position - glm::vec3(model[3])) - SPHERE_RADIUS;
+		//culling happens in model space, where the patch and chunk bounds live
+		eye_model = glm::vec3(glm::inverse(model) * glm::vec4(main_camera.position, 1.0f));
+		frustum = extract_frustum(frame.projection * frame.view * model);
+		if (chunk_mode) {
+			queue.submit(program->ID, 0, MATERIAL_SPHERE, sphere_depth, RENDER_OPAQUE, [&]() {
+				PROFILE_GPU_ZONE("chunks");
+				program->set_float("lod_morph", 0.0f);
+				chunks.draw(program, model, frustum, eye_model, glm::radians(main_camera.zoom), WINDOW_HEIGHT);
+			});
+		}
+		else if (tessellation_mode && tessellation_ready) {
+			queue.submit(tessellated.program->ID, 0, MATERIAL_SPHERE, sphere_depth, RENDER_OPAQUE, [&]() {
+				PROFILE_GPU_ZONE("tessellated");
+				tessellated.draw(model, main_camera.position, glm::radians(main_camera.zoom), WINDOW_HEIGHT);
+			});
+		}
+		else {
+			lod = sphere.select(glm::vec3(model[3]), main_camera.position, glm::radians(main_camera.zoom), WINDOW_HEIGHT);
+			queue.submit(program->ID, sphere.vertex_array(lod), MATERIAL_SPHERE, sphere_depth, RENDER_OPAQUE, [&]() {
+				PROFILE_ZONE("sphere_draw");
+				PROFILE_GPU_ZONE("sphere");
+				program->set_float("lod_morph", lod.morph);
+				sphere.draw(lod, frustum, eye_model);
+			});
+		}
 
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		if (pick_requested) {
+			pick_requested = false;
+			if (picker.pick(screen_ray(frame.view, frame.projection, WINDOW_WIDTH / 2.0, WINDOW_HEIGHT / 2.0, WINDOW_WIDTH, WINDOW_HEIGHT), model, &hit))
+				printf("Picked face %d row %d column %d (triangle %u) at %.3f %.3f %.3f\n", hit.face, hit.row, hit.column, hit.triangle, hit.point.x, hit.point.y, hit.point.z);
+		}
+
+		if (impostor_mode && impostors_ready) {
+			{
+				PROFILE_ZONE("impostors");
+				sphere_instance* region = impostors.map(instance_positions.size());
+				for (size_t i = 0; i < instance_positions.size(); i++) {
+					region[i].position_radius = glm::vec4(instance_positions[i], 0.4f);
+					region[i].color = glm::vec4(instance_directions[i] * 0.5f + 0.5f, 1.0f);
+				}
+				impostors.unmap();
+			}
+			queue.submit(impostors.program->ID, impostors.VAO, MATERIAL_INSTANCES, fabsf(glm::length(main_camera.position) - INSTANCE_SHELL_RADIUS), RENDER_OPAQUE, [&]() {
+				PROFILE_GPU_ZONE("impostors");
+				impostors.program->set_int("shininess", shininess);
+				impostors.program->set_float("ambient_stren", ambient_str);
+				impostors.program->set_float("specular_stren", specular_str);
+				impostors.draw();
+			});
+		}
+		else {
+			{
+				PROFILE_ZONE("instances");
+				for (size_t i = 0; i < instance_handles.size(); i++)
+					instances.update(instance_handles[i], instance_positions[i], 0.4f);
+				instances.upload();
+			}
+			queue.submit(program->ID, instance_buffer.VAO, MATERIAL_INSTANCES, fabsf(glm::length(main_camera.position) - INSTANCE_SHELL_RADIUS), RENDER_OPAQUE, [&]() {
+				PROFILE_GPU_ZONE("instances");
+				program->set_float("lod_morph", 0.0f); //instances use a single level, so they never morph
+				instances.draw(instance_buffer);
+			});
+		}
+		queue.flush();
+
+		{
+			PROFILE_ZONE("swap");
+			glfwSwapBuffers(window);
+			glfwPollEvents();
+		}
+		profiler.end_frame();
+		if (profile_requested) {
+			profile_requested = false;
+			profiler.print_summary();
+			if (profiler.write_chrome_trace(PROFILE_TRACE_PATH))
+				printf("Wrote %s\n", PROFILE_TRACE_PATH);
+		}
 	}
 
+	world.stop();
+	if (options.trace_path)
+		profiler.write_chrome_trace(options.trace_path);
+	profiler.release();
+	shader_watcher.close();
+	instances.release();
+	impostors.release();
+	tessellated.release();
+	frame_buffer.release();
+	instance_buffer.release();
+	sphere.release();
+	chunks.release();
 	glfwTerminate();
 	return 0;
 }
@@ -172,6 +320,18 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
 void keyboard_input_callback(GLFWwindow* window, int key, int scancode, int action, int mod) {
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, true);
+	if (key == GLFW_KEY_T && action == GLFW_PRESS)
+		tessellation_mode = !tessellation_mode;
+	if (key == GLFW_KEY_C && action == GLFW_PRESS)
+		chunk_mode = !chunk_mode;
+	if (key == GLFW_KEY_I && action == GLFW_PRESS)
+		impostor_mode = !impostor_mode;
+	if (key == GLFW_KEY_P && action == GLFW_PRESS)
+		profile_requested = true;
+}
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mod) {
+	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
+		pick_requested = true;
 }
 void mouse_input_callback(GLFWwindow* window, double x_pos, double y_pos) {
 	if (first_mouse) {
@@ -186,186 +346,84 @@ double y_diff = last_y - y_pos;
 last_x = x_pos;
 last_y = y_pos;
 
-main_camera.process_mouse(x_diff, y_diff);
+input_state.mouse_x += x_diff;
+input_state.mouse_y += y_diff;
 }
 void process_input(GLFWwindow* window) {
 
-	//WASD movment
+	//WASD movment, applied by the simulation every tick the keys are down
+	input_state.keys = 0;
 	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-		main_camera.process_keyboard(FORWARD, delta_time);
+		input_state.keys |= SIMULATION_KEY_FORWARD;
 	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-		main_camera.process_keyboard(LEFT, delta_time);
+		input_state.keys |= SIMULATION_KEY_LEFT;
 	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-		main_camera.process_keyboard(BACKWARD, delta_time);
+		input_state.keys |= SIMULATION_KEY_BACKWARD;
 	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-		main_camera.process_keyboard(RIGHT, delta_time);
-
-}
-
-//Create an equalaterial triangle with no z-value
-void create_equalaterial_triangle(std::vector<glm::vec3>* buffer, glm::vec3 position, double side_len) {
-	double base_half = side_len / 2;
-	double height_half = side_len * glm::cos(glm::pi<double>() / 6) / 2;
-
-	buffer->push_back(glm::vec3(base_half, -height_half, 0.0f));
-	buffer->push_back(glm::vec3(0, height_half, 0.0f));
-	buffer->push_back(glm::vec3(-base_half, -height_half, 0.0f));
+		input_state.keys |= SIMULATION_KEY_RIGHT;
 
 }
 
-//Breakdown equalaterial triangle into polyogns shaped as equalateral trianlges
-void recursive_equalaterial(std::vector<glm::vec3>* buffer, int iteration) {
-	if (iteration == 0)
-		return;
-	int total_vertices = pow(4, iteration) * 3; //number of polygons * number of vertices per polygon
-	int rows = pow(2, iteration);
-	int current_sub_triangle = 0; //holds current polygon being created
-	int dequeue_index = 0, delta = 3, assigned = 0;
-	bool is_flipped = false, use_left = false, first_triple = false; //flages for alternating polygons
-	glm::vec3 displacment = buffer->at(1) - buffer->at(0);
-	double side = sqrt(displacment.x * displacment.x + displacment.y * displacment.y + displacment.z * displacment.z); //side length of equalaterial triangle
-	double sub_side_len = side / rows; //length of each polygon 
-	double sub_base_len = sub_side_len * glm::cos(glm::pi<float>() / 3); //base of octahedron face
-	double sub_height_len = sub_side_len * glm::cos(glm::pi<float>() / 6); //height octahedron face
-	double dihedral_angle = glm::acos(-1 / 3); //base angles of triangle on xz-plane
-	double beta_angle = 180.0f - dihedral_angle; //beta angle for law of sines
-	double sub_depth_len = glm::sin(glm::radians(dihedral_angle / 2)) / glm::sin(glm::radians(beta_angle)) * sub_side_len; //Using Law of Sines to determine value of sub_depth_len
-
-	//Setup for queue
-	glm::vec3 top_vertex = buffer->at(1);
-	std::queue<calculated_vertex*, std::list<calculated_vertex*>> calculated_vertices;
-	calculated_vertex* init_pair = new calculated_vertex;
-	init_pair->right = top_vertex;
-	calculated_vertices.push(init_pair);
-	buffer->clear();
-
-	/* Diagram of triangle position data
-	[vertex + 1]   [vertex + 4] [vertex + 3]
-		  / \			\        /
-		 /   \			 \      /
-		/     \			  \    /
-	   /       \		   \  /
-	  /_________\           \/				.....
-[vertex + 2]  [vertex]	[vertex +  5]
-	*/
-	//adds positional data for polygon into buffer as shown above; uses verteices from previous row to reduce number of calculations
-	for (int vertex = 0; vertex < total_vertices; vertex += 3) {
-		calculated_vertex* sub_vertex;
-		//if polygon is standing upright
-		if (!is_flipped) {
-			if (use_left) { //uses bottom left vertex value from polygon above
-				buffer->push_back(glm::vec3(calculated_vertices.front()->left.x + sub_base_len, calculated_vertices.front()->left.y - sub_height_len, calculated_vertices.front()->left.z - sub_depth_len)); //bottom left vertex
-				buffer->push_back(calculated_vertices.front()->left); //top vertex
-				buffer->push_back(glm::vec3(calculated_vertices.front()->left.x - sub_base_len, calculated_vertices.front()->left.y - sub_height_len, calculated_vertices.front()->left.z - sub_depth_len)); //bottom right vertex
-				use_left = false;
-			}
-			else { //uses bottom right vertex value from polygon above
-				buffer->push_back(glm::vec3(calculated_vertices.front()->right.x + sub_base_len, calculated_vertices.front()->right.y - sub_height_len, calculated_vertices.front()->right.z - sub_depth_len)); //bottom left vertex
-				buffer->push_back(calculated_vertices.front()->right); //top vertex
-				buffer->push_back(glm::vec3(calculated_vertices.front()->right.x - sub_base_len, calculated_vertices.front()->right.y - sub_height_len, calculated_vertices.front()->right.z - sub_depth_len)); //bottom right vertex
-				use_left = true;
-			}
-			sub_vertex = create_calculated_pair(buffer->at(static_cast<unsigned __int64>(vertex) + 2), buffer->at(vertex)); //create vertex pair generated 
-			calculated_vertices.push(sub_vertex); //push vertex pair onto queue
-			is_flipped = true;
-		}
-		//if polyogn is upside down
-		else { //uses both left and right bottom vertex values from polygon above
-			buffer->push_back(calculated_vertices.front()->right); //top right vertex
-			buffer->push_back(calculated_vertices.front()->left); //top left vertex
-			buffer->push_back(glm::vec3(calculated_vertices.front()->left.x + sub_base_len, calculated_vertices.front()->left.y - sub_height_len, calculated_vertices.front()->left.z - sub_depth_len)); //bottom vertex
-			is_flipped = false;
-		}
-		assigned++; //update number of polygons generated by vertex in front of queue
-
-		//Dequeue vertex if current polygon being generated is last one of the row
-		if (current_sub_triangle == dequeue_index) { 
-			free(calculated_vertices.front());
-			calculated_vertices.pop();
-			dequeue_index += delta;
-			delta += 2;
-			assigned = 0;
-			is_flipped = false;
-			first_triple = false;
-		}
-
-		//Dequeues inital vertex after first 3 polyons generated
-		else if (assigned == 3 && !first_triple) {
-			free(calculated_vertices.front());
-			calculated_vertices.pop();
-			assigned = 0;
-			if (use_left)
-				use_left = false;
-			else
-				use_left = true;
-			first_triple = true;
-		}
-		//Dequeue vertex if vertex is used to generate 2 polygons
-		else if(first_triple && assigned == 2){
-			free(calculated_vertices.front());
-			calculated_vertices.pop();
-			assigned = 0;
-			if (use_left)
-				use_left = false;
-			else
-				use_left = true;
+//Command line
+bool parse_arguments(int argc, char** argv, bool* headless, benchmark_options* options) {
+	for (int i = 1; i < argc; i++) {
+		bool has_value = i + 1 < argc;
+		if (!strcmp(argv[i], "--headless"))
+			*headless = true;
+		else if (!strcmp(argv[i], "--frames") && has_value)
+			options->frames = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--width") && has_value)
+			options->width = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--height") && has_value)
+			options->height = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--threads") && has_value)
+			options->threads = unsigned(atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--csv") && has_value)
+			options->csv_path = argv[++i];
+		else if (!strcmp(argv[i], "--json") && has_value)
+			options->json_path = argv[++i];
+		else if (!strcmp(argv[i], "--trace") && has_value)
+			options->trace_path = argv[++i];
+		else if (!strcmp(argv[i], "--tessellation"))
+			options->tessellation = true;
+		else if (!strcmp(argv[i], "--chunks"))
+			options->chunks = true;
+		else if (!strcmp(argv[i], "--impostors") && has_value)
+			options->impostors = atoi(argv[++i]);
+		else {
+			fprintf(stderr, "Unknown option: %s\n", argv[i]);
+			fprintf(stderr, "Usage: %s [--headless] [--frames N] [--width W] [--height H] [--threads N] [--csv file] [--json file] [--trace file] [--tessellation] [--chunks] [--impostors N]\n", argv[0]);
+			fprintf(stderr, "  --headless renders the benchmark camera path offscreen and exits\n");
+			fprintf(stderr, "  --trace writes a Chrome trace of the profiled zones on exit\n");
+			fprintf(stderr, "  --tessellation renders the path a second time with GPU tessellation\n");
+			fprintf(stderr, "  --chunks renders the path again from streamed sphere chunks\n");
+			fprintf(stderr, "  --impostors renders the path again with N ray-cast spheres streamed around the main one\n");
+			return false;
 		}
-		current_sub_triangle++;
 	}
-
-}
-
-//Create octahedron using equalateral triangle
-void rotate_triangle(std::vector<glm::vec3>* buffer) {
-	int new_buffer_size = buffer->size() * 3; //3 additional triangles to be added
-	float height = buffer->at(1).y * 2; //doubled because buffer holds half of the full height
-	glm::mat4 rotation_y, rotation_z, translate_y; //matrices used for transformation of initial triangle
-	glm::vec4 bottom_half; //holds vertex for bottom portion of octahedron
-	rotation_y = glm::rotate(rotation_y, glm::pi<float>() / 2, glm::vec3(0.0f, 1.0f, 0.0f)); //rotation around y-axis
-	rotation_z = glm::rotate(rotation_z, glm::pi<float>(), glm::vec3(0.0f, 0.0f, 1.0f)); //rotation around z-axis; for proper orientation 
-	translate_y = glm::translate(translate_y, glm::vec3(0.0f, -height, 0.0f)); //translate z-rotation to bottom for correct placment
-
-	//add vertices for top half of octahedron
-	for (int i = 0; i < new_buffer_size; i++) {
-		buffer->push_back(glm::vec4(buffer->at(i), 1.0f) * rotation_y);
-	}
-
-	//add vertices for bottom half of octahedron
-	new_buffer_size = buffer->size();
-	for (int i = 0; i < new_buffer_size; i++) {
-		bottom_half = glm::vec4(buffer->at(i), 1.0f) * rotation_z;
-		bottom_half.y -= height;
-		buffer->push_back(bottom_half);
+	if (options->frames < 1 || options->width < 1 || options->height < 1) {
+		fprintf(stderr, "Frames, width and height must be positive\n");
+		return false;
 	}
+	return true;
 }
 
-//Normalizes vertices of octahedron to become a sphere
-void sphere_normalization(std::vector<glm::vec3>* buffer, double radius, glm::vec3 origin) {
-	int buffer_size = buffer->size();
-	float dx, dy, dz;
-	glm::vec3 sphere_vertex;
-	for(int i = 0; i < buffer_size; i++){
-		//displacement components from origin to vertex on octahedron
-		dx = buffer->at(i).x - origin.x;
-		dy = buffer->at(i).y - origin.y;
-		dz = buffer->at(i).z - origin.z;
-		
-		//convert displacement to be relative to sphere surface
-		dx = dx * radius / glm::distance(origin, buffer->at(i));
-		dy = dy * radius / glm::distance(origin, buffer->at(i));
-		dz = dz * radius / glm::distance(origin, buffer->at(i));
-		sphere_vertex = glm::vec3(dx, dy, dz);
-		buffer->at(i) = sphere_vertex;
-	}
-}
+//Benchmark without a window; returns the process exit code
+int run_headless(const benchmark_options& options) {
+	headless_context context;
+	benchmark_report report;
+	bool completed;
 
-
-//Create calculated pair vertices; struct calculated_vertex
-calculated_vertex* create_calculated_pair(glm::vec3 left, glm::vec3 right) {
-	calculated_vertex* pair = new calculated_vertex;
-	pair->left = left;
-	pair->right = right;
-	return pair;
+	if (!context.create(options.width, options.height))
+		return 1;
+	std::cout << "OpenGL version supported: " << glGetString(GL_VERSION) << std::endl;
+
+	shader_program headless_program("src/shader/basic_vertex.glsl", "src/shader/basic_fragment.glsl");
+	completed = run_benchmark(options, &headless_program, &report);
+	glDeleteProgram(headless_program.ID);
+	gl_state.program_deleted(headless_program.ID);
+	context.destroy();
+	return completed ? 0 : 1;
 }
 
 //Debugging functions
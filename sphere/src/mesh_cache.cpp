@@ -0,0 +1,248 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "../header/mesh_cache.h"
+
+/*----- Mapped file -----*/
+#ifdef _WIN32
+mapped_file::mapped_file() : data(NULL), size(0), file_handle(INVALID_HANDLE_VALUE), mapping_handle(NULL) {}
+#else
+mapped_file::mapped_file() : data(NULL), size(0), file_descriptor(-1) {}
+#endif
+mapped_file::~mapped_file() {
+	close();
+}
+
+bool mapped_file::open(const char* file_path) {
+	close();
+#ifdef _WIN32
+	LARGE_INTEGER file_size;
+	file_handle = CreateFileA(file_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file_handle == INVALID_HANDLE_VALUE)
+		return false;
+	if (!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0) {
+		close();
+		return false;
+	}
+	mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping_handle == NULL) {
+		close();
+		return false;
+	}
+	data = (const unsigned char*)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+	size = size_t(file_size.QuadPart);
+#else
+	struct stat file_stat;
+	file_descriptor = ::open(file_path, O_RDONLY);
+	if (file_descriptor < 0)
+		return false;
+	if (fstat(file_descriptor, &file_stat) != 0 || file_stat.st_size == 0) {
+		close();
+		return false;
+	}
+	void* mapping = mmap(NULL, size_t(file_stat.st_size), PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+	if (mapping == MAP_FAILED) {
+		close();
+		return false;
+	}
+	madvise(mapping, size_t(file_stat.st_size), MADV_SEQUENTIAL); //read once front to back by checksum and upload
+	data = (const unsigned char*)mapping;
+	size = size_t(file_stat.st_size);
+#endif
+	if (data == NULL) {
+		close();
+		return false;
+	}
+	return true;
+}
+void mapped_file::close() {
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping_handle)
+		CloseHandle(mapping_handle);
+	if (file_handle != INVALID_HANDLE_VALUE)
+		CloseHandle(file_handle);
+	mapping_handle = NULL;
+	file_handle = INVALID_HANDLE_VALUE;
+#else
+	if (data)
+		munmap((void*)data, size);
+	if (file_descriptor >= 0)
+		::close(file_descriptor);
+	file_descriptor = -1;
+#endif
+	data = NULL;
+	size = 0;
+}
+
+/*----- Mesh cache -----*/
+uint64_t mesh_cache_checksum(const void* data, size_t size, uint64_t hash) {
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+//Compared field by field so a corrupt header cannot wrap the sum around and pass
+static bool region_in_file(uint64_t offset, uint64_t bytes, uint64_t file_size) {
+	return offset <= file_size && bytes <= file_size - offset;
+}
+
+//Counts must be the closed-form ones for the level and the byte sizes must follow from them
+static bool header_consistent(const mesh_cache_header& header) {
+	size_t index_size;
+	if (header.vertex_count != sphere_vertex_count(header.level) || header.index_count != 3 * uint64_t(sphere_triangle_count(header.level)))
+		return false;
+	if (header.index_type != sphere_index_type(size_t(header.vertex_count)))
+		return false;
+	index_size = header.index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	return header.index_bytes == header.index_count * index_size
+		&& header.vertex_bytes == make_vertex_layout(vertex_layout_id(header.vertex_layout)).buffer_size(size_t(header.vertex_count));
+}
+
+mesh_cache::mesh_cache() : header(NULL) {}
+
+bool mesh_cache::open(const char* file_path, int level, double radius, vertex_layout_id layout, bool verify_checksum) {
+	close();
+	if (!file.open(file_path))
+		return false;
+
+	const mesh_cache_header* candidate = (const mesh_cache_header*)file.data;
+	if (file.size < sizeof(mesh_cache_header) || candidate->magic != MESH_CACHE_MAGIC || candidate->version != MESH_CACHE_VERSION) {
+		fprintf(stderr, "Ignoring mesh cache %s: not a version %d cache\n", file_path, MESH_CACHE_VERSION);
+		close();
+		return false;
+	}
+	if (candidate->level != level || candidate->radius != radius || candidate->vertex_layout != uint32_t(layout)) {
+		close();
+		return false;
+	}
+	if (!region_in_file(candidate->vertex_offset, candidate->vertex_bytes, file.size) || !region_in_file(candidate->index_offset, candidate->index_bytes, file.size)
+		|| !region_in_file(candidate->patch_offset, 0, file.size) || candidate->patch_count > (file.size - candidate->patch_offset) / sizeof(sphere_patch)) {
+		fprintf(stderr, "Ignoring mesh cache %s: truncated\n", file_path);
+		close();
+		return false;
+	}
+	//the checksum covers only the payload, so the counts the buffers are set up and drawn with are checked against it here
+	if (!header_consistent(*candidate)) {
+		fprintf(stderr, "Ignoring mesh cache %s: header does not match its level\n", file_path);
+		close();
+		return false;
+	}
+	if (verify_checksum) {
+		uint64_t checksum = mesh_cache_checksum(file.data + candidate->vertex_offset, size_t(candidate->vertex_bytes));
+		checksum = mesh_cache_checksum(file.data + candidate->index_offset, size_t(candidate->index_bytes), checksum);
+		checksum = mesh_cache_checksum(file.data + candidate->patch_offset, size_t(candidate->patch_count * sizeof(sphere_patch)), checksum);
+		if (checksum != candidate->checksum) {
+			fprintf(stderr, "Ignoring mesh cache %s: checksum mismatch\n", file_path);
+			close();
+			return false;
+		}
+	}
+
+	header = candidate;
+	return true;
+}
+void mesh_cache::close() {
+	file.close();
+	header = NULL;
+}
+
+const void* mesh_cache::vertex_data() const {
+	return header ? file.data + header->vertex_offset : NULL;
+}
+const void* mesh_cache::index_data() const {
+	return header ? file.data + header->index_offset : NULL;
+}
+const sphere_patch* mesh_cache::patch_data() const {
+	return header ? (const sphere_patch*)(file.data + header->patch_offset) : NULL;
+}
+
+//Writes a block and folds it into the running checksum
+static bool write_block(FILE* fp, const void* data, size_t size, uint64_t* checksum) {
+	*checksum = mesh_cache_checksum(data, size, *checksum);
+	return fwrite(data, 1, size, fp) == size;
+}
+
+bool write_mesh_cache(const char* file_path, const sphere_mesh& mesh, vertex_layout_id layout_id, thread_pool* pool) {
+	mesh_cache_header header;
+	std::vector<GLushort> packed;
+	std::vector<unsigned char> vertex_bytes;
+	char temporary_path[512];
+	FILE* fp;
+	bool written = true;
+	size_t vertex_count = mesh.positions.size();
+	vertex_layout layout = make_vertex_layout(vertex_layout_with_morph(layout_id, mesh.morph_targets.size() == vertex_count));
+
+	if (layout.id == VERTEX_LAYOUT_CUSTOM)
+		return false;
+	vertex_bytes.resize(layout.buffer_size(vertex_count));
+	layout.encode(mesh, vertex_bytes.data(), pool);
+
+	memset(&header, 0, sizeof(header));
+	header.magic = MESH_CACHE_MAGIC;
+	header.version = MESH_CACHE_VERSION;
+	header.level = mesh.level;
+	header.vertex_layout = layout.id;
+	header.radius = mesh.radius;
+	header.index_type = sphere_index_type(vertex_count);
+	header.vertex_count = vertex_count;
+	header.index_count = mesh.indices.size();
+	header.vertex_offset = sizeof(mesh_cache_header);
+	header.vertex_bytes = vertex_bytes.size();
+	header.index_offset = header.vertex_offset + header.vertex_bytes;
+	header.index_bytes = mesh.indices.size() * (header.index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint));
+	header.patch_offset = header.index_offset + header.index_bytes;
+	header.patch_count = mesh.patches.size();
+	header.checksum = 14695981039346656037ULL;
+
+	snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", file_path);
+	fp = fopen(temporary_path, "wb");
+	if (fp == NULL) {
+		fprintf(stderr, "Failed to write mesh cache: %s\n", temporary_path);
+		return false;
+	}
+
+	//header goes first with a placeholder checksum and is rewritten once the payload is hashed
+	written = fwrite(&header, sizeof(header), 1, fp) == 1;
+	written = written && write_block(fp, vertex_bytes.data(), vertex_bytes.size(), &header.checksum);
+	if (header.index_type == GL_UNSIGNED_SHORT) {
+		packed.assign(mesh.indices.begin(), mesh.indices.end());
+		written = written && write_block(fp, packed.data(), packed.size() * sizeof(GLushort), &header.checksum);
+	}
+	else
+		written = written && write_block(fp, mesh.indices.data(), mesh.indices.size() * sizeof(GLuint), &header.checksum);
+	written = written && write_block(fp, mesh.patches.data(), mesh.patches.size() * sizeof(sphere_patch), &header.checksum);
+	written = written && fseek(fp, 0L, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, fp) == 1;
+	written = (fclose(fp) == 0) && written;
+
+	if (!written) {
+		fprintf(stderr, "Failed to write mesh cache: %s\n", temporary_path);
+		remove(temporary_path);
+		return false;
+	}
+	remove(file_path); //rename does not replace existing files on Windows
+	if (rename(temporary_path, file_path) != 0) {
+		fprintf(stderr, "Failed to move mesh cache into place: %s\n", file_path);
+		remove(temporary_path);
+		return false;
+	}
+	return true;
+}
+
+void mesh_cache_path(char* out, size_t out_size, int level, double radius) {
+	snprintf(out, out_size, "sphere_l%d_r%g.mesh", level, radius);
+}
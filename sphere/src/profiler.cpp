@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include "../header/profiler.h"
+
+frame_profiler profiler;
+
+static thread_local uint32_t zone_depth = 0;
+
+uint64_t frame_profiler::now() {
+	static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+float profile_stats::percentile(float fraction) const {
+	std::vector<float> sorted(window);
+	if (sorted.empty())
+		return 0.0f;
+	size_t rank = size_t(fraction * float(sorted.size() - 1) + 0.5f);
+	std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+	return sorted[rank];
+}
+
+frame_profiler::frame_profiler() : gpu_dropped(0), frame_start(0), gpu_state(0), frame_index(0), gpu_depth(0) {
+	enabled = true;
+	gpu_events.id = 0;
+	gpu_events.written = 0;
+	gpu_events.drained = 0;
+	for (int i = 0; i < PROFILER_GPU_FRAMES; i++)
+		gpu_frames[i].zone_count = 0;
+}
+
+/*----- CPU zones -----*/
+//Each thread writes to its own ring, registered the first time it records a zone
+frame_profiler::thread_events* frame_profiler::local_events() {
+	static thread_local thread_events* events = NULL;
+	if (events)
+		return events;
+
+	std::lock_guard<std::mutex> guard(threads_lock);
+	threads.push_back(std::unique_ptr<thread_events>(new thread_events()));
+	events = threads.back().get();
+	events->id = uint32_t(threads.size()); //0 is the GPU track
+	events->written = 0;
+	events->drained = 0;
+	return events;
+}
+
+void frame_profiler::append(thread_events* target, const profile_event& event) {
+	std::lock_guard<std::mutex> guard(target->lock);
+	if (target->events.size() < PROFILER_EVENT_CAPACITY)
+		target->events.push_back(event);
+	else
+		target->events[target->written % PROFILER_EVENT_CAPACITY] = event;
+	target->written++;
+}
+
+void frame_profiler::record(const char* name, uint64_t start, uint64_t end, uint32_t depth) {
+	profile_event event;
+	event.name = name;
+	event.start = start;
+	event.duration = end - start;
+	event.depth = depth;
+	append(local_events(), event);
+}
+
+profile_zone::profile_zone(const char* name) : name(name), start(0) {
+	if (!profiler.enabled.load(std::memory_order_relaxed))
+		return;
+	start = frame_profiler::now();
+	zone_depth++;
+}
+profile_zone::~profile_zone() {
+	if (start == 0)
+		return;
+	zone_depth--;
+	profiler.record(name, start, frame_profiler::now(), zone_depth);
+}
+
+/*----- Statistics -----*/
+void frame_profiler::add_sample(const char* name, bool gpu, float ms) {
+	profile_stats* entry = NULL;
+	for (size_t i = 0; i < zone_stats.size() && !entry; i++) {
+		if (zone_stats[i].gpu == gpu && zone_stats[i].name == name)
+			entry = &zone_stats[i];
+	}
+	if (!entry) {
+		zone_stats.push_back(profile_stats());
+		entry = &zone_stats.back();
+		entry->name = name;
+		entry->gpu = gpu;
+		entry->count = 0;
+		entry->total_ms = 0.0;
+		entry->max_ms = 0.0f;
+	}
+
+	if (entry->window.size() < PROFILER_WINDOW)
+		entry->window.push_back(ms);
+	else
+		entry->window[entry->count % PROFILER_WINDOW] = ms;
+	entry->count++;
+	entry->total_ms += ms;
+	entry->max_ms = ms > entry->max_ms ? ms : entry->max_ms;
+}
+
+//Folds events recorded since the last drain into the statistics; events overwritten before then are skipped
+void frame_profiler::drain(thread_events* source, bool gpu) {
+	std::lock_guard<std::mutex> guard(source->lock);
+	uint64_t first = source->written > PROFILER_EVENT_CAPACITY ? source->written - PROFILER_EVENT_CAPACITY : 0;
+	for (uint64_t i = std::max(first, source->drained); i < source->written; i++) {
+		const profile_event& event = source->events[i % PROFILER_EVENT_CAPACITY];
+		add_sample(event.name, gpu, float(double(event.duration) / 1.0e6));
+	}
+	source->drained = source->written;
+}
+
+std::vector<profile_stats> frame_profiler::stats() {
+	std::lock_guard<std::mutex> guard(stats_lock);
+	std::vector<profile_stats> snapshot(zone_stats);
+	std::sort(snapshot.begin(), snapshot.end(), [](const profile_stats& a, const profile_stats& b) {
+		return a.name != b.name ? a.name < b.name : a.gpu < b.gpu;
+	});
+	return snapshot;
+}
+
+void frame_profiler::print_summary() {
+	std::vector<profile_stats> snapshot = stats();
+
+	printf("%-24s %4s %8s %10s %10s %10s %10s\n", "zone", "", "samples", "mean ms", "p50 ms", "p99 ms", "max ms");
+	for (size_t i = 0; i < snapshot.size(); i++) {
+		const profile_stats& entry = snapshot[i];
+		printf("%-24s %4s %8zu %10.3f %10.3f %10.3f %10.3f\n", entry.name.c_str(), entry.gpu ? "gpu" : "cpu", entry.count,
+			entry.total_ms / double(entry.count), entry.percentile(0.5f), entry.percentile(0.99f), entry.max_ms);
+	}
+	if (gpu_dropped)
+		printf("%zu GPU zones dropped: results not ready within %d frames\n", gpu_dropped, PROFILER_GPU_FRAMES);
+}
+
+/*----- Frames and GPU zones -----*/
+void frame_profiler::begin_frame() {
+	int slot = int(frame_index % PROFILER_GPU_FRAMES);
+	GLint64 gpu_now = 0;
+
+	frame_start = now();
+	if (gpu_state == 0) {
+		GLint counter_bits = 0;
+		glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counter_bits);
+		gpu_state = counter_bits > 0 ? 1 : -1;
+		if (gpu_state == 1)
+			glGenQueries(PROFILER_GPU_FRAMES * 2 * PROFILER_GPU_ZONES, &queries[0][0]);
+	}
+	if (gpu_state != 1)
+		return;
+
+	if (gpu_frames[slot].zone_count > 0)
+		read_gpu_frame(slot);
+	gpu_frames[slot].zone_count = 0;
+	gpu_depth = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+	gpu_frames[slot].offset = int64_t(now()) - int64_t(gpu_now);
+}
+
+void frame_profiler::end_frame() {
+	if (enabled.load(std::memory_order_relaxed))
+		record("frame", frame_start, now(), 0);
+
+	std::lock_guard<std::mutex> guard(stats_lock);
+	std::vector<thread_events*> sources;
+	{
+		std::lock_guard<std::mutex> threads_guard(threads_lock);
+		for (size_t i = 0; i < threads.size(); i++)
+			sources.push_back(threads[i].get());
+	}
+	for (size_t i = 0; i < sources.size(); i++)
+		drain(sources[i], false);
+	drain(&gpu_events, true);
+	frame_index++;
+}
+
+int frame_profiler::gpu_begin(const char* name) {
+	gpu_frame& frame = gpu_frames[frame_index % PROFILER_GPU_FRAMES];
+	if (gpu_state != 1 || !enabled.load(std::memory_order_relaxed) || frame.zone_count == PROFILER_GPU_ZONES)
+		return -1;
+
+	int zone = frame.zone_count++;
+	frame.names[zone] = name;
+	frame.depths[zone] = gpu_depth++;
+	glQueryCounter(queries[frame_index % PROFILER_GPU_FRAMES][2 * zone], GL_TIMESTAMP);
+	return zone;
+}
+void frame_profiler::gpu_end(int zone) {
+	if (zone < 0)
+		return;
+	glQueryCounter(queries[frame_index % PROFILER_GPU_FRAMES][2 * zone + 1], GL_TIMESTAMP);
+	gpu_depth--;
+}
+
+//Never waits: a zone whose end timestamp has not landed yet is counted as dropped
+void frame_profiler::read_gpu_frame(int slot) {
+	gpu_frame& frame = gpu_frames[slot];
+	for (int zone = 0; zone < frame.zone_count; zone++) {
+		GLint available = GL_FALSE;
+		GLuint64 begin = 0, end = 0;
+		profile_event event;
+
+		glGetQueryObjectiv(queries[slot][2 * zone + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			gpu_dropped++;
+			continue;
+		}
+		glGetQueryObjectui64v(queries[slot][2 * zone], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(queries[slot][2 * zone + 1], GL_QUERY_RESULT, &end);
+		event.name = frame.names[zone];
+		event.start = uint64_t(int64_t(begin) + frame.offset);
+		event.duration = end > begin ? end - begin : 0;
+		event.depth = frame.depths[zone];
+		append(&gpu_events, event);
+	}
+	frame.zone_count = 0;
+}
+
+gpu_profile_zone::gpu_profile_zone(const char* name) : zone(profiler.gpu_begin(name)) {}
+gpu_profile_zone::~gpu_profile_zone() {
+	profiler.gpu_end(zone);
+}
+
+void frame_profiler::release() {
+	if (gpu_state == 1)
+		glDeleteQueries(PROFILER_GPU_FRAMES * 2 * PROFILER_GPU_ZONES, &queries[0][0]);
+	gpu_state = 0;
+	for (int i = 0; i < PROFILER_GPU_FRAMES; i++)
+		gpu_frames[i].zone_count = 0;
+}
+
+/*----- Chrome trace -----*/
+static void write_trace_events(FILE* fp, const std::vector<profile_event>& events, uint64_t written, uint32_t thread, bool* first) {
+	uint64_t begin = written > PROFILER_EVENT_CAPACITY ? written - PROFILER_EVENT_CAPACITY : 0;
+	for (uint64_t i = begin; i < written; i++) {
+		const profile_event& event = events[i % PROFILER_EVENT_CAPACITY];
+		fprintf(fp, "%s\n{\"name\":\"", *first ? "" : ",");
+		for (const char* c = event.name; *c; c++) {
+			if (*c == '"' || *c == '\\')
+				fputc('\\', fp);
+			fputc(*c, fp);
+		}
+		fprintf(fp, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%u}}",
+			thread, double(event.start) / 1000.0, double(event.duration) / 1000.0, event.depth);
+		*first = false;
+	}
+}
+
+bool frame_profiler::write_chrome_trace(const char* file_path) {
+	FILE* fp = fopen(file_path, "w");
+	bool first = false;
+	std::vector<thread_events*> sources;
+
+	if (!fp) {
+		fprintf(stderr, "Failed to open trace file %s\n", file_path);
+		return false;
+	}
+	{
+		std::lock_guard<std::mutex> guard(threads_lock);
+		for (size_t i = 0; i < threads.size(); i++)
+			sources.push_back(threads[i].get());
+	}
+	sources.push_back(&gpu_events);
+
+	//track names first, so viewers label the GPU track and number the CPU threads in registration order
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	fprintf(fp, "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}");
+	for (size_t i = 0; i + 1 < sources.size(); i++)
+		fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}", sources[i]->id, sources[i]->id);
+	for (size_t i = 0; i < sources.size(); i++) {
+		std::lock_guard<std::mutex> guard(sources[i]->lock);
+		write_trace_events(fp, sources[i]->events, sources[i]->written, sources[i]->id, &first);
+	}
+	fprintf(fp, "\n]}\n");
+
+	if (fclose(fp) != 0) {
+		fprintf(stderr, "Failed to write trace file %s\n", file_path);
+		return false;
+	}
+	return true;
+}
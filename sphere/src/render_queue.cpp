@@ -0,0 +1,121 @@
+#include <string.h>
+#include <utility>
+#include "../header/render_queue.h"
+#include "../header/gl_state.h"
+#include "../header/profiler.h"
+
+#define RENDER_DEPTH_BITS 24
+#define RENDER_DEPTH_MAX ((1u << RENDER_DEPTH_BITS) - 1)
+
+/*----- Radix sort -----*/
+void radix_sort_keys(uint64_t* keys, uint32_t* values, size_t count, uint64_t* key_scratch, uint32_t* value_scratch) {
+	size_t histograms[8][256];
+	uint64_t* key_from = keys, * key_to = key_scratch;
+	uint32_t* value_from = values, * value_to = value_scratch;
+
+	if (count < 2)
+		return;
+
+	//one read builds all eight histograms
+	memset(histograms, 0, sizeof(histograms));
+	for (size_t i = 0; i < count; i++) {
+		for (int pass = 0; pass < 8; pass++)
+			histograms[pass][(keys[i] >> (8 * pass)) & 0xFF]++;
+	}
+
+	for (int pass = 0; pass < 8; pass++) {
+		size_t* histogram = histograms[pass];
+		int shift = 8 * pass;
+		size_t offset = 0;
+
+		//keys built from a few fields leave most bytes constant across a frame
+		if (histogram[(key_from[0] >> shift) & 0xFF] == count)
+			continue;
+		for (int digit = 0; digit < 256; digit++) {
+			size_t digit_count = histogram[digit];
+			histogram[digit] = offset;
+			offset += digit_count;
+		}
+		for (size_t i = 0; i < count; i++) {
+			size_t target = histogram[(key_from[i] >> shift) & 0xFF]++;
+			key_to[target] = key_from[i];
+			value_to[target] = value_from[i];
+		}
+		std::swap(key_from, key_to);
+		std::swap(value_from, value_to);
+	}
+
+	if (key_from != keys) {
+		memcpy(keys, key_from, count * sizeof(uint64_t));
+		memcpy(values, value_from, count * sizeof(uint32_t));
+	}
+}
+
+/*----- Render queue -----*/
+render_queue::render_queue(float depth_range) : depth_range(depth_range) {}
+
+//Slots are handed out in submission order; once they run out, the last slot is shared
+uint32_t render_queue::slot(std::vector<GLuint>* slots, GLuint name, uint32_t limit) {
+	for (size_t i = 0; i < slots->size(); i++) {
+		if ((*slots)[i] == name)
+			return uint32_t(i);
+	}
+	if (slots->size() == limit)
+		return limit - 1;
+	slots->push_back(name);
+	return uint32_t(slots->size() - 1);
+}
+
+void render_queue::submit(GLuint program, GLuint VAO, uint32_t material, float depth, uint32_t flags, std::function<void()> draw, int layer) {
+	render_command command;
+	float normalized = depth_range > 0.0f ? depth / depth_range : 0.0f;
+	uint64_t key;
+
+	normalized = normalized < 0.0f ? 0.0f : (normalized > 1.0f ? 1.0f : normalized);
+	key = uint64_t(layer & 0xF) << 60;
+	key |= uint64_t(slot(&program_slots, program, RENDER_KEY_PROGRAMS)) << 52;
+	key |= uint64_t(flags & 0xF) << 48;
+	key |= uint64_t(slot(&vertex_array_slots, VAO, RENDER_KEY_VERTEX_ARRAYS)) << 36;
+	key |= uint64_t(material % RENDER_KEY_MATERIALS) << RENDER_DEPTH_BITS;
+	key |= uint64_t(normalized * float(RENDER_DEPTH_MAX));
+
+	command.program = program;
+	command.VAO = VAO;
+	command.flags = flags;
+	command.draw = std::move(draw);
+	commands.push_back(std::move(command));
+	keys.push_back(key);
+}
+
+size_t render_queue::flush() {
+	PROFILE_ZONE("render_flush");
+	size_t count = commands.size();
+
+	order.resize(count);
+	key_scratch.resize(count);
+	order_scratch.resize(count);
+	for (size_t i = 0; i < count; i++)
+		order[i] = uint32_t(i);
+	radix_sort_keys(keys.data(), order.data(), count, key_scratch.data(), order_scratch.data());
+
+	for (size_t i = 0; i < count; i++) {
+		render_command& command = commands[order[i]];
+		gl_state.set_capability(GL_STATE_DEPTH_TEST, (command.flags & RENDER_DEPTH_TEST) != 0);
+		gl_state.set_depth_write((command.flags & RENDER_DEPTH_WRITE) != 0);
+		gl_state.set_capability(GL_STATE_CULL_FACE, (command.flags & RENDER_CULL_FACE) != 0);
+		gl_state.use_program(command.program);
+		if (command.VAO)
+			gl_state.bind_vertex_array(command.VAO);
+		command.draw();
+	}
+
+	commands.clear();
+	keys.clear();
+	program_slots.clear();
+	vertex_array_slots.clear();
+	return count;
+}
+
+size_t render_queue::size() const {
+	return commands.size();
+}
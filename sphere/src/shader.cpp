@@ -1,119 +1,341 @@
+#include <string.h>
+#include <thread>
 #include "../header/shader.h"
+#include "../header/shader_cache.h"
+#include "../header/thread_pool.h"
+#include "../header/profiler.h"
+#include "../header/gl_state.h"
 
-shader_program::shader_program() { ID = -1; }
-shader_program::shader_program(const char* vertex_path, const char* fragment_path) {
-	GLuint* shader_IDs;
-	GLint linked;
-	const char* shader_paths[2] = { vertex_path, fragment_path };
+static uint32_t uniform_hash(const char* name) {
+	uint32_t hash = 2166136261u;
+	for (; *name; name++)
+		hash = (hash ^ (unsigned char)*name) * 16777619u;
+	return hash;
+}
 
-	shader_IDs = compile_shader(shader_paths);
-	
-	ID = glCreateProgram();
-	if (!ID) {
-		fprintf(stderr, "Failed to create shader program using IDs: %d, %d\n", shader_IDs[0], shader_IDs[1]);
-		exit(EXIT_FAILURE);
+//Worker thread reader: reports a missing file instead of exiting, so the program can end up FAILED
+static bool read_source(const char* file_path, std::string* out) {
+	FILE* fp = fopen(file_path, "rb");
+	long length;
+
+	if (fp == NULL) {
+		fprintf(stderr, "Failed to read file: %s\n", file_path);
+		return false;
 	}
-	glAttachShader(ID, shader_IDs[0]);
-	glAttachShader(ID, shader_IDs[1]);
-	
-	glLinkProgram(ID);
-	glGetProgramiv(ID, GL_LINK_STATUS, &linked);
-	if (!linked) {
-		GLint log_size;
-		char* log_msg;
-		fprintf(stderr, "Shader program failed to link; ID: %d\n", ID);
-		glGetProgramiv(ID, GL_INFO_LOG_LENGTH, &log_size);
-		log_msg = new char[log_size];
-		glGetProgramInfoLog(ID, log_size, NULL, log_msg);
-		perror(log_msg);
-		delete[] log_msg;
-		system("pause");
+	fseek(fp, 0L, SEEK_END);
+	length = ftell(fp);
+	fseek(fp, 0L, SEEK_SET);
+	out->resize(length > 0 ? size_t(length) : 0);
+	out->resize(fread(&(*out)[0], 1, out->size(), fp));
+	fclose(fp);
+	return true;
+}
+
+shader_program::shader_program() : ID(0), status(SHADER_EMPTY), from_cache(false), building(0), cache_identity(0), cache_key(0) {}
+shader_program::shader_program(const char* vertex_path, const char* fragment_path) : shader_program() {
+	const char* shader_paths[2] = { vertex_path, fragment_path };
+	const GLenum shader_types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	build(shader_paths, shader_types, 2);
+}
+shader_program::shader_program(const char* vertex_path, const char* tess_control_path, const char* tess_evaluation_path, const char* fragment_path) : shader_program() {
+	const char* shader_paths[4] = { vertex_path, tess_control_path, tess_evaluation_path, fragment_path };
+	const GLenum shader_types[4] = { GL_VERTEX_SHADER, GL_TESS_CONTROL_SHADER, GL_TESS_EVALUATION_SHADER, GL_FRAGMENT_SHADER };
+	build(shader_paths, shader_types, 4);
+}
+//Blocking constructors keep their old contract: the program is usable on return or the process exits
+void shader_program::build(const char** shader_paths, const GLenum* shader_types, int shader_count) {
+	load_async(shader_paths, shader_types, shader_count, NULL);
+	if (!wait())
 		exit(EXIT_FAILURE);
+}
+void shader_program::use() {
+	gl_state.use_program(ID);
+}
+
+/*----- Asynchronous loading -----*/
+/* Diagram of states
+	EMPTY --load_async--> READING --files read, poll()--> COMPILING --driver done, poll()--> READY
+	                         |                        \--cached binary accepted---------------^
+	                         \--missing file-------------------------> FAILED <--compile or link error
+	only poll() touches GL; the pool thread only reads files
+*/
+void shader_program::load_async(const char** shader_paths, const GLenum* shader_types, int shader_count, thread_pool* pool) {
+	std::shared_ptr<shader_sources> sources = std::make_shared<shader_sources>();
+
+	sources->paths.assign(shader_paths, shader_paths + shader_count);
+	sources->types.assign(shader_types, shader_types + shader_count);
+	sources->failed = false;
+	sources->done = false;
+	source_paths = sources->paths;
+	source_types = sources->types;
+	abandon();
+	pending = sources;
+	status = SHADER_READING;
+
+	//the task holds its own reference, so the program may be destroyed while the files are still being read
+	std::function<void()> read = [sources]() {
+		PROFILE_ZONE("shader_read");
+		sources->texts.resize(sources->paths.size());
+		for (size_t i = 0; i < sources->paths.size(); i++) {
+			if (!read_source(sources->paths[i].c_str(), &sources->texts[i]))
+				sources->failed = true;
+		}
+		sources->done.store(true, std::memory_order_release);
+	};
+	if (pool)
+		pool->submit(read);
+	else
+		read();
+}
+
+bool shader_program::poll() {
+	if (status == SHADER_READING) {
+		if (!pending->done.load(std::memory_order_acquire))
+			return false;
+		if (pending->failed) {
+			status = SHADER_FAILED;
+			pending.reset();
+			return true;
+		}
+		start_link();
+		return status != SHADER_COMPILING;
+	}
+	if (status == SHADER_COMPILING) {
+		//without the extension the status query below simply blocks until the driver is done
+		if (gl_extensions.parallel_shader_compile) {
+			GLint completed = GL_FALSE;
+			glGetProgramiv(building, GL_COMPLETION_STATUS_KHR, &completed);
+			if (!completed)
+				return false;
+		}
+		finish_link();
 	}
+	return true;
+}
 
-	glDeleteShader(shader_IDs[0]);
-	glDeleteShader(shader_IDs[1]);
-	free(shader_IDs);
-}	
-void shader_program::use() {
-	glUseProgram(ID);
-}
-GLuint* shader_program::compile_shader(const char** shader_paths) {
-	GLint compiled;
-	GLuint* shader_IDs = new GLuint[2]; //[0]: vertex id; [1]: fragment id
-	const char* shader_source[2];  //[0]: vertex source; [1]: fragment source
-
-	printf("Attempting to read: %s\n", shader_paths[0]);
-	shader_source[0] = read_file(shader_paths[0]);
-	printf("Attempting to read: %s\n", shader_paths[1]);
-	shader_source[1] = read_file(shader_paths[1]);
-
-	shader_IDs[0] = glCreateShader(GL_VERTEX_SHADER);
-	shader_IDs[1] = glCreateShader(GL_FRAGMENT_SHADER);
-
-	for (int i = 0; i < 2; i++) {
-		glShaderSource(shader_IDs[i], 1, (const GLchar**)&shader_source[i], NULL);
-		glCompileShader(shader_IDs[i]);
-		glGetShaderiv(shader_IDs[i], GL_COMPILE_STATUS, &compiled);
-
-		if (!compiled) {
-			GLint log_size;
-			char* log_msg;
-			fprintf(stderr, "%s failed to compile\n", shader_paths[i]);
+//Loads the same files again; ID keeps working until the new program links, and stays if it does not
+void shader_program::reload(thread_pool* pool) {
+	std::vector<const char*> paths;
+
+	if (source_paths.empty())
+		return;
+	for (size_t i = 0; i < source_paths.size(); i++)
+		paths.push_back(source_paths[i].c_str());
+	std::vector<GLenum> types = source_types;
+	load_async(paths.data(), types.data(), int(paths.size()), pool);
+}
+
+//Drops a load still in flight; a pool thread still reading only holds on to its own copy of the sources
+void shader_program::abandon() {
+	for (size_t i = 0; i < shader_IDs.size(); i++)
+		glDeleteShader(shader_IDs[i]);
+	shader_IDs.clear();
+	if (building)
+		glDeleteProgram(building);
+	building = 0;
+	pending.reset();
+}
+
+bool shader_program::wait() {
+	while (!poll())
+		std::this_thread::yield();
+	return status == SHADER_READY;
+}
+
+//Issues every compile and the link without asking for results, so the driver can overlap them
+void shader_program::start_link() {
+	PROFILE_ZONE("shader_link");
+	building = glCreateProgram();
+	cache_identity = shader_cache_identity(pending->paths, pending->types);
+	cache_key = shader_cache_key(pending->texts, pending->types);
+	if (load_program_binary(building, cache_identity, cache_key)) {
+		from_cache = true;
+		adopt();
+		return;
+	}
+
+	from_cache = false;
+	shader_IDs.clear();
+	for (size_t i = 0; i < pending->texts.size(); i++) {
+		const GLchar* source = pending->texts[i].c_str();
+		GLuint shader = glCreateShader(pending->types[i]);
+		glShaderSource(shader, 1, &source, NULL);
+		glCompileShader(shader);
+		glAttachShader(building, shader);
+		shader_IDs.push_back(shader);
+	}
+	if (gl_extensions.program_parameteri)
+		gl_extensions.program_parameteri(building, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(building);
+	status = SHADER_COMPILING;
+}
+
+void shader_program::finish_link() {
+	PROFILE_ZONE("shader_finish_link");
+	GLint linked;
+
+	glGetProgramiv(building, GL_LINK_STATUS, &linked);
+	if (!linked) {
+		std::vector<char> log_msg;
+		GLint compiled, log_size;
+
+		//a stage that failed to compile explains the link failure better than the link log does
+		for (size_t i = 0; i < shader_IDs.size(); i++) {
+			glGetShaderiv(shader_IDs[i], GL_COMPILE_STATUS, &compiled);
+			if (compiled)
+				continue;
 			glGetShaderiv(shader_IDs[i], GL_INFO_LOG_LENGTH, &log_size);
-			log_msg = new char[log_size];
-			glGetShaderInfoLog(shader_IDs[i], log_size, NULL, log_msg);
-			fprintf(stderr, "\nReason:\n%s\n", log_msg);
-			delete[] log_msg;
-			system("pause");
-			exit(EXIT_FAILURE);
+			log_msg.assign(size_t(log_size) + 1, '\0');
+			glGetShaderInfoLog(shader_IDs[i], log_size, NULL, log_msg.data());
+			fprintf(stderr, "%s failed to compile\n\nReason:\n%s\n", pending->paths[i].c_str(), log_msg.data());
 		}
-		printf("Successfully compiled %s\nID: %d\n", shader_paths[i], i);
+		glGetProgramiv(building, GL_INFO_LOG_LENGTH, &log_size);
+		log_msg.assign(size_t(log_size) + 1, '\0');
+		glGetProgramInfoLog(building, log_size, NULL, log_msg.data());
+		fprintf(stderr, "Shader program failed to link; ID: %d\n%s\n", building, log_msg.data());
+
+		abandon();
+		status = SHADER_FAILED;
+		return;
 	}
 
-	return shader_IDs;
+	for (size_t i = 0; i < shader_IDs.size(); i++)
+		glDeleteShader(shader_IDs[i]);
+	shader_IDs.clear();
+	save_program_binary(building, cache_identity, cache_key);
+	adopt();
+}
+
+//The previous program, if any, stays in use until its replacement has linked
+void shader_program::adopt() {
+	printf("Shader program %d ready%s: %s\n", building, from_cache ? " from cache" : "", pending->paths[0].c_str());
+	if (ID) {
+		glDeleteProgram(ID);
+		gl_state.program_deleted(ID);
+	}
+	ID = building;
+	building = 0;
+	status = SHADER_READY;
+	pending.reset();
+	introspect_uniforms();
+	for (size_t i = 0; i < block_bindings.size(); i++)
+		apply_block_binding(block_bindings[i].first.c_str(), block_bindings[i].second);
+}
+
+/*----- Uniform lookup -----*/
+//Locations are fixed once linked, so every active uniform is looked up a single time here
+void shader_program::introspect_uniforms() {
+	GLint active_count, max_length, size;
+	GLenum type;
+	size_t table_size = 16;
+
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &active_count);
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+	while (table_size < size_t(active_count) * 2)
+		table_size *= 2;
+	uniforms.assign(table_size, uniform_slot());
+
+	std::vector<char> name(size_t(max_length) + 1);
+	for (GLint i = 0; i < active_count; i++) {
+		GLint location;
+		char* bracket;
+		uint32_t hash;
+		size_t slot;
+
+		glGetActiveUniform(ID, GLuint(i), GLsizei(name.size()), NULL, &size, &type, name.data());
+		location = glGetUniformLocation(ID, name.data());
+		if (location < 0)
+			continue; //members of uniform blocks have no location
+		bracket = strstr(name.data(), "[0]"); //arrays are reported as "name[0]" but set as "name"
+		if (bracket)
+			*bracket = '\0';
+
+		hash = uniform_hash(name.data());
+		slot = hash & (uniforms.size() - 1);
+		while (!uniforms[slot].name.empty())
+			slot = (slot + 1) & (uniforms.size() - 1);
+		uniforms[slot].name = name.data();
+		uniforms[slot].hash = hash;
+		uniforms[slot].location = location;
+		uniforms[slot].type = type;
+		uniforms[slot].size = size;
+		uniforms[slot].uploaded = false;
+	}
 }
+const uniform_slot* shader_program::find_uniform(const char* name) const {
+	uint32_t hash;
+	size_t slot;
 
+	if (uniforms.empty())
+		return NULL;
+	hash = uniform_hash(name);
+	slot = hash & (uniforms.size() - 1);
+	while (!uniforms[slot].name.empty()) {
+		if (uniforms[slot].hash == hash && uniforms[slot].name == name)
+			return &uniforms[slot];
+		slot = (slot + 1) & (uniforms.size() - 1);
+	}
+	return NULL;
+}
+GLint shader_program::get_location(const char* name) const {
+	const uniform_slot* uniform = find_uniform(name);
+	return uniform ? uniform->location : -1;
+}
+//False when the uniform is inactive or already holds value; otherwise records value as uploaded
+bool shader_program::changed(const char* name, const void* value, size_t size, GLint* location) {
+	uniform_slot* uniform = (uniform_slot*)find_uniform(name);
+
+	if (!uniform)
+		return false;
+	*location = uniform->location;
+	if (uniform->size > 1)
+		return true;
+	if (uniform->uploaded && !memcmp(uniform->value, value, size))
+		return false;
+	memcpy(uniform->value, value, size);
+	uniform->uploaded = true;
+	return true;
+}
+//Remembered so a reloaded program gets the same bindings
+void shader_program::bind_uniform_block(const char* name, GLuint binding) {
+	size_t i = 0;
+	while (i < block_bindings.size() && block_bindings[i].first != name)
+		i++;
+	if (i == block_bindings.size())
+		block_bindings.push_back(std::make_pair(std::string(name), binding));
+	block_bindings[i].second = binding;
+	if (ID)
+		apply_block_binding(name, binding);
+}
+void shader_program::apply_block_binding(const char* name, GLuint binding) {
+	GLuint block_index = glGetUniformBlockIndex(ID, name);
+	if (block_index != GL_INVALID_INDEX)
+		glUniformBlockBinding(ID, block_index, binding);
+}
 /*----- Set uniform variables -----*/
-void shader_program::set_bool(const char* name, GLboolean& value) { glUniform1i(glGetUniformLocation(ID,name), value); };
-void shader_program::set_int(const char* name, GLint& value) { glUniform1i(glGetUniformLocation(ID,name), value); };
-void shader_program::set_float(const char* name, GLfloat& value) { glUniform1f(glGetUniformLocation(ID,name), value); };
-void shader_program::set_double(const char* name, GLdouble &value) { glUniform1d(glGetUniformLocation(ID,name), value); };
+void shader_program::set_bool(const char* name, GLboolean value) { GLint location; if (changed(name, &value, sizeof(value), &location)) glUniform1i(location, value); };
+void shader_program::set_int(const char* name, GLint value) { GLint location; if (changed(name, &value, sizeof(value), &location)) glUniform1i(location, value); };
+void shader_program::set_float(const char* name, GLfloat value) { GLint location; if (changed(name, &value, sizeof(value), &location)) glUniform1f(location, value); };
+void shader_program::set_double(const char* name, GLdouble value) { GLint location; if (changed(name, &value, sizeof(value), &location)) glUniform1d(location, value); };
 
 /*----- set uniform vectors -----*/
-void shader_program::set_vec2(const char* name, const glm::vec2 &value) { glUniform2fv(glGetUniformLocation(ID, name), 1, &value[0]); };
-void shader_program::set_vec3(const char* name, const glm::vec3 &value) { glUniform3fv(glGetUniformLocation(ID,name), 1, &value[0]); };
-void shader_program::set_vec4(const char* name, const glm::vec4 &value) { glUniform4fv(glGetUniformLocation(ID,name), 1, &value[0]); };
+void shader_program::set_vec2(const char* name, const glm::vec2 &value) { GLint location; if (changed(name, &value, sizeof(value), &location)) glUniform2fv(location, 1, &value[0]); };
+void shader_program::set_vec3(const char* name, const glm::vec3 &value) { GLint location; if (changed(name, &value, sizeof(value), &location)) glUniform3fv(location, 1, &value[0]); };
+void shader_program::set_vec4(const char* name, const glm::vec4 &value) { GLint location; if (changed(name, &value, sizeof(value), &location)) glUniform4fv(location, 1, &value[0]); };
 
 /*----- set uniform matrices ----*/
-void shader_program::set_mat2(const char* name, const glm::mat2 &value) { glUniformMatrix2fv(glGetUniformLocation(ID,name), 1, GL_FALSE, &value[0][0]); };
-void shader_program::set_mat3(const char* name, const glm::mat3 &value) { glUniformMatrix3fv(glGetUniformLocation(ID,name), 1, GL_FALSE, &value[0][0]); };
-void shader_program::set_mat4(const char* name, const glm::mat4 &value) { glUniformMatrix4fv(glGetUniformLocation(ID,name), 1, GL_FALSE, &value[0][0]); };
+void shader_program::set_mat2(const char* name, const glm::mat2 &value) { GLint location; if (changed(name, &value, sizeof(value), &location)) glUniformMatrix2fv(location, 1, GL_FALSE, &value[0][0]); };
+void shader_program::set_mat3(const char* name, const glm::mat3 &value) { GLint location; if (changed(name, &value, sizeof(value), &location)) glUniformMatrix3fv(location, 1, GL_FALSE, &value[0][0]); };
+void shader_program::set_mat4(const char* name, const glm::mat4 &value) { GLint location; if (changed(name, &value, sizeof(value), &location)) glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]); };
 
+//Whole file as a NUL terminated string, read in binary so offsets match on every platform; delete[] it
 const char* read_file(const char* file_path) {
-	FILE* fp;
-	long length;
+	std::string text;
 	char* buffer;
 
-	errno_t err = fopen_s(&fp, file_path, "r");
-	if (fp == NULL) {
-		fprintf(stderr, "Failed to read file: %s\n", file_path);
-		system("pause");
-		exit(EXIT_FAILURE);
-	}
-	printf("Successfully read %s\n", file_path);
-	fseek(fp, 0L, SEEK_END);
-	length = ftell(fp);
-
-	fseek(fp, 0L, SEEK_SET);
-	buffer = new char[static_cast<_int64>(length) + 1];
-	fread(buffer, sizeof(char), static_cast<_int64>(length) + 1, fp);
-	buffer[length] = '\0';
-	fclose(fp);
-
-	for (int i = 0; i < length; i++) {
-		if (!(buffer[i] >= 0 && buffer[i] <= 128))
-			buffer[i] = ' ';
-	}
+	if (!read_source(file_path, &text))
+		return NULL;
+	buffer = new char[text.size() + 1];
+	memcpy(buffer, text.c_str(), text.size() + 1);
 	return buffer;
 }
@@ -5,9 +5,13 @@ in vec3 color;
 in vec3 normal;
 in vec3 frag_pos;
 
-uniform vec3 light_color;
-uniform vec3 light_pos;
-uniform vec3 viewer_pos;
+layout (std140) uniform frame {
+	mat4 view;
+	mat4 projection;
+	vec3 light_color;
+	vec3 light_pos;
+	vec3 viewer_pos;
+};
 
 uniform int shininess;
 uniform float ambient_stren;
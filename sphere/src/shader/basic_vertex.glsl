@@ -2,22 +2,42 @@
 #version 330 core
 
 layout (location = 0) in vec3 vPosition;
-layout (location = 1) in vec3 vNormal;
+layout (location = 1) in vec3 vNormal; //zero when the layout stores octahedral normals instead
 layout (location = 2) in vec4 vColor;
+layout (location = 3) in vec3 vMorph; //position on the next coarser LOD level
+layout (location = 4) in vec4 iPositionRadius; //per instance center and radius; (0, 0, 0, 1) when not instanced
+layout (location = 5) in vec4 iColor; //per instance color, alpha blends it over vColor; (0, 0, 0, 0) when not instanced
+layout (location = 6) in vec2 vNormalOct; //octahedral encoded normal from compact vertex layouts
 
 out vec3 color;
 out vec3 normal;
 out vec3 frag_pos;
 
-uniform mat4 projection;
-uniform mat4 view;
+layout (std140) uniform frame { //updated once per frame, shared with the fragment shader
+	mat4 view;
+	mat4 projection;
+	vec3 light_color;
+	vec3 light_pos;
+	vec3 viewer_pos;
+};
 uniform mat4 model;
+uniform float lod_morph; //0 keeps vPosition, 1 moves fully onto vMorph
+
+//Unfolds a normal flattened onto the octahedron |x| + |y| + |z| = 1
+vec3 decode_octahedral(vec2 e){
+	vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0f);
+	n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+	return normalize(n);
+}
 
 void main(){
-	frag_pos = vec3(model * vec4(vPosition, 1.0f));
+	vec3 local_pos = mix(vPosition, vMorph, lod_morph) * iPositionRadius.w + iPositionRadius.xyz;
+	frag_pos = vec3(model * vec4(local_pos, 1.0f));
 
-	color = vec3(vColor.rgb);
-	normal = mat3(transpose(inverse(model))) * vNormal;
+	color = mix(vColor.rgb, iColor.rgb, iColor.a);
+	vec3 local_normal = dot(vNormal, vNormal) > 0.0f ? vNormal : decode_octahedral(vNormalOct);
+	normal = mat3(transpose(inverse(model))) * local_normal;
 
 	gl_Position = projection * view * vec4(frag_pos, 1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,52 @@
+/*----- Impostor Fragment Shader -----*/
+#version 330 core
+#extension GL_ARB_conservative_depth : enable
+
+in vec3 ray_point;
+flat in vec3 sphere_center;
+flat in float sphere_radius;
+flat in vec3 color;
+
+layout (std140) uniform frame {
+	mat4 view;
+	mat4 projection;
+	vec3 light_color;
+	vec3 light_pos;
+	vec3 viewer_pos;
+};
+
+uniform int shininess;
+uniform float ambient_stren;
+uniform float specular_stren;
+
+out vec4 frag_color;
+//The front of the sphere is always nearer than the quad through its center, so early depth testing can stay on
+#ifdef GL_ARB_conservative_depth
+layout (depth_less) out float gl_FragDepth;
+#endif
+
+void main(){
+	//ray from the eye through this pixel; the offset form stays precise for small spheres far away
+	vec3 direction = normalize(ray_point);
+	float along = dot(direction, sphere_center);
+	vec3 offset = sphere_center - along * direction;
+	float disc = sphere_radius * sphere_radius - dot(offset, offset);
+	if (disc < 0.0f)
+		discard;
+
+	vec3 hit = direction * (along - sqrt(disc));
+	vec3 norm = (hit - sphere_center) / sphere_radius;
+	vec4 clip = projection * vec4(hit, 1.0f);
+	gl_FragDepth = 0.5f * clip.z / clip.w + 0.5f; //default glDepthRange(0, 1)
+
+	//same terms as basic_fragment.glsl, in view space where the eye is the origin
+	vec3 light = vec3(view * vec4(light_pos, 1.0f));
+	vec3 light_dir = normalize(light - hit);
+	vec3 ambient = ambient_stren * light_color;
+	vec3 diffuse = max(dot(norm, light_dir), 0.0f) * light_color;
+	vec3 reflect_dir = reflect(-light_dir, norm);
+	float spec = pow(max(dot(normalize(-hit), reflect_dir), 0.0f), float(shininess));
+	vec3 specular = specular_stren * spec * light_color;
+
+	frag_color = vec4((ambient + diffuse + specular) * color, 1.0f);
+}
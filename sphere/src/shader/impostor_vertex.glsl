@@ -0,0 +1,46 @@
+/*----- Impostor Vertex Shader -----*/
+#version 330 core
+
+layout (location = 4) in vec4 iPositionRadius; //world space center and radius, same instance layout as basic_vertex.glsl
+layout (location = 5) in vec4 iColor;
+
+out vec3 ray_point; //view space point on the quad; the eye sits at the origin
+flat out vec3 sphere_center;
+flat out float sphere_radius;
+flat out vec3 color;
+
+layout (std140) uniform frame {
+	mat4 view;
+	mat4 projection;
+	vec3 light_color;
+	vec3 light_pos;
+	vec3 viewer_pos;
+};
+
+//Triangle strip corners, picked by gl_VertexID so no vertex buffer is needed
+const vec2 corners[4] = vec2[4](vec2(-1.0f, -1.0f), vec2(1.0f, -1.0f), vec2(-1.0f, 1.0f), vec2(1.0f, 1.0f));
+
+//The quad faces the eye through the sphere's center and is sized to the circle where the cone of rays
+//touching the sphere crosses it, so it covers the silhouette exactly under perspective
+void main(){
+	vec3 center = vec3(view * vec4(iPositionRadius.xyz, 1.0f));
+	float radius = iPositionRadius.w;
+	float distance_squared = dot(center, center);
+
+	sphere_center = center;
+	sphere_radius = radius;
+	color = iColor.rgb;
+	if (distance_squared <= radius * radius) { //eye inside the sphere: every corner lands on one point, nothing is drawn
+		ray_point = center;
+		gl_Position = vec4(0.0f, 0.0f, 2.0f, 1.0f);
+		return;
+	}
+
+	vec3 axis = center * inversesqrt(distance_squared);
+	vec3 right = normalize(cross(axis, abs(axis.y) < 0.99f ? vec3(0.0f, 1.0f, 0.0f) : vec3(1.0f, 0.0f, 0.0f)));
+	vec3 up = cross(right, axis);
+	float half_size = radius * sqrt(distance_squared / (distance_squared - radius * radius));
+
+	ray_point = center + (right * corners[gl_VertexID].x + up * corners[gl_VertexID].y) * half_size;
+	gl_Position = projection * vec4(ray_point, 1.0f);
+}
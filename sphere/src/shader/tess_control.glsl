@@ -0,0 +1,45 @@
+/*----- Tessellation Control Shader -----*/
+#version 400 core
+
+layout (vertices = 3) out;
+
+in vec3 control_pos[];
+in vec3 control_color[];
+
+out vec3 eval_pos[];
+out vec3 eval_color[];
+
+uniform vec3 eye; //camera in model space
+uniform float sphere_radius;
+uniform float pixel_scale; //viewport_height / (2 * tan(fov_y / 2))
+uniform float target_edge_pixels;
+uniform float max_tess_level;
+
+/* Diagram of edge levels
+	        v0
+	       /  \
+	  [1] /    \ [2]
+	     /      \
+	   v2--------v1
+	       [0]
+	gl_TessLevelOuter[i] is the edge opposite corner i. A level only depends on the edge's two end points,
+	so both patches sharing the edge pick the same level and no cracks open between them.
+*/
+float edge_level(vec3 a, vec3 b){
+	vec3 mid = normalize(a + b) * sphere_radius;
+	float arc = sphere_radius * acos(clamp(dot(normalize(a), normalize(b)), -1.0f, 1.0f));
+	float pixels = arc * pixel_scale / max(distance(eye, mid), 1e-4f);
+	return clamp(pixels / target_edge_pixels, 1.0f, max_tess_level);
+}
+
+void main(){
+	eval_pos[gl_InvocationID] = control_pos[gl_InvocationID];
+	eval_color[gl_InvocationID] = control_color[gl_InvocationID];
+
+	if (gl_InvocationID == 0) {
+		gl_TessLevelOuter[0] = edge_level(control_pos[1], control_pos[2]);
+		gl_TessLevelOuter[1] = edge_level(control_pos[2], control_pos[0]);
+		gl_TessLevelOuter[2] = edge_level(control_pos[0], control_pos[1]);
+		gl_TessLevelInner[0] = max(gl_TessLevelOuter[0], max(gl_TessLevelOuter[1], gl_TessLevelOuter[2]));
+	}
+}
@@ -0,0 +1,33 @@
+/*----- Tessellation Evaluation Shader -----*/
+#version 400 core
+
+layout (triangles, equal_spacing, ccw) in;
+
+in vec3 eval_pos[];
+in vec3 eval_color[];
+
+out vec3 color;
+out vec3 normal;
+out vec3 frag_pos;
+
+layout (std140) uniform frame {
+	mat4 view;
+	mat4 projection;
+	vec3 light_color;
+	vec3 light_pos;
+	vec3 viewer_pos;
+};
+uniform mat4 model;
+uniform float sphere_radius;
+
+//New vertices are placed on the flat patch and pushed out onto the sphere, like generate_sphere_mesh does
+void main(){
+	vec3 flat_pos = gl_TessCoord.x * eval_pos[0] + gl_TessCoord.y * eval_pos[1] + gl_TessCoord.z * eval_pos[2];
+	vec3 direction = normalize(flat_pos);
+	frag_pos = vec3(model * vec4(direction * sphere_radius, 1.0f));
+
+	color = gl_TessCoord.x * eval_color[0] + gl_TessCoord.y * eval_color[1] + gl_TessCoord.z * eval_color[2];
+	normal = mat3(transpose(inverse(model))) * direction;
+
+	gl_Position = projection * view * vec4(frag_pos, 1.0f);
+}
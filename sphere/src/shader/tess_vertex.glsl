@@ -0,0 +1,14 @@
+/*----- Tessellation Vertex Shader -----*/
+#version 400 core
+
+layout (location = 0) in vec3 vPosition;
+layout (location = 2) in vec4 vColor;
+
+out vec3 control_pos;
+out vec3 control_color;
+
+//Corners go through untouched; everything is projected after the evaluation stage
+void main(){
+	control_pos = vPosition;
+	control_color = vColor.rgb;
+}
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <string.h>
+#include "../header/shader_cache.h"
+#include "../header/mesh_cache.h"
+#include "../header/gl_extensions.h"
+
+uint64_t shader_cache_key(const std::vector<std::string>& sources, const std::vector<GLenum>& types) {
+	const GLenum driver_strings[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	uint64_t key = 14695981039346656037ULL;
+
+	for (int i = 0; i < 3; i++) {
+		const char* driver = (const char*)glGetString(driver_strings[i]);
+		if (driver)
+			key = mesh_cache_checksum(driver, strlen(driver) + 1, key);
+	}
+	for (size_t i = 0; i < sources.size(); i++) {
+		key = mesh_cache_checksum(&types[i], sizeof(GLenum), key);
+		key = mesh_cache_checksum(sources[i].data(), sources[i].size() + 1, key);
+	}
+	return key;
+}
+
+uint64_t shader_cache_identity(const std::vector<std::string>& paths, const std::vector<GLenum>& types) {
+	uint64_t identity = 14695981039346656037ULL;
+	for (size_t i = 0; i < paths.size(); i++) {
+		identity = mesh_cache_checksum(&types[i], sizeof(GLenum), identity);
+		identity = mesh_cache_checksum(paths[i].data(), paths[i].size() + 1, identity);
+	}
+	return identity;
+}
+
+void shader_cache_path(char* out, size_t out_size, uint64_t identity) {
+	snprintf(out, out_size, "shader_%016llx.bin", (unsigned long long)identity);
+}
+
+bool program_binary_supported() {
+	GLint formats = 0;
+	if (!gl_extensions.get_program_binary || !gl_extensions.program_binary)
+		return false;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+bool load_program_binary(GLuint program, uint64_t identity, uint64_t key) {
+	char file_path[64];
+	mapped_file file;
+	GLint linked = GL_FALSE;
+
+	if (!program_binary_supported())
+		return false;
+	shader_cache_path(file_path, sizeof(file_path), identity);
+	if (!file.open(file_path))
+		return false;
+
+	const shader_cache_header* header = (const shader_cache_header*)file.data;
+	if (file.size < sizeof(shader_cache_header) || header->magic != SHADER_CACHE_MAGIC || header->version != SHADER_CACHE_VERSION
+		|| header->identity != identity || header->binary_bytes > file.size - sizeof(shader_cache_header)) {
+		fprintf(stderr, "Ignoring shader cache %s: not a matching version %d cache\n", file_path, SHADER_CACHE_VERSION);
+		return false;
+	}
+	if (header->key != key) //sources or driver changed since it was saved; the next save replaces it
+		return false;
+	if (mesh_cache_checksum(file.data + sizeof(shader_cache_header), size_t(header->binary_bytes)) != header->checksum) {
+		fprintf(stderr, "Ignoring shader cache %s: checksum mismatch\n", file_path);
+		return false;
+	}
+
+	//drivers reject binaries from other versions themselves; the program is then simply not linked
+	gl_extensions.program_binary(program, GLenum(header->binary_format), file.data + sizeof(shader_cache_header), GLsizei(header->binary_bytes));
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	return linked == GL_TRUE;
+}
+
+bool save_program_binary(GLuint program, uint64_t identity, uint64_t key) {
+	shader_cache_header header;
+	std::vector<unsigned char> binary;
+	char file_path[64], temporary_path[72];
+	GLint length = 0;
+	GLsizei written_length = 0;
+	GLenum format = 0;
+	FILE* fp;
+	bool written;
+
+	if (!program_binary_supported())
+		return false;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return false;
+	binary.resize(size_t(length));
+	gl_extensions.get_program_binary(program, length, &written_length, &format, binary.data());
+	if (written_length <= 0)
+		return false;
+
+	memset(&header, 0, sizeof(header));
+	header.magic = SHADER_CACHE_MAGIC;
+	header.version = SHADER_CACHE_VERSION;
+	header.binary_format = format;
+	header.identity = identity;
+	header.key = key;
+	header.binary_bytes = uint64_t(written_length);
+	header.checksum = mesh_cache_checksum(binary.data(), size_t(written_length));
+
+	shader_cache_path(file_path, sizeof(file_path), identity);
+	snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", file_path);
+	fp = fopen(temporary_path, "wb");
+	if (fp == NULL) {
+		fprintf(stderr, "Failed to write shader cache: %s\n", temporary_path);
+		return false;
+	}
+	written = fwrite(&header, sizeof(header), 1, fp) == 1;
+	written = written && fwrite(binary.data(), 1, size_t(written_length), fp) == size_t(written_length);
+	written = (fclose(fp) == 0) && written;
+	if (!written) {
+		fprintf(stderr, "Failed to write shader cache: %s\n", temporary_path);
+		remove(temporary_path);
+		return false;
+	}
+	remove(file_path); //rename does not replace existing files on Windows
+	if (rename(temporary_path, file_path) != 0) {
+		fprintf(stderr, "Failed to move shader cache into place: %s\n", file_path);
+		remove(temporary_path);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,39 @@
+#include "../header/simd.h"
+#if defined(SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static simd_level query_simd_level() {
+#if defined(SIMD_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool fma = (info[2] & (1 << 12)) != 0;
+	bool os_avx = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6; //OS saves ymm registers
+	__cpuidex(info, 7, 0);
+	bool avx2 = (info[1] & (1 << 5)) != 0;
+	if (fma && os_avx && avx2)
+		return SIMD_AVX2;
+	return SIMD_SSE;
+#elif defined(SIMD_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return SIMD_AVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return SIMD_SSE;
+	return SIMD_SCALAR;
+#else
+	return SIMD_SCALAR;
+#endif
+}
+
+simd_level detect_simd_level() {
+	static simd_level level = query_simd_level();
+	return level;
+}
+const char* simd_level_name(simd_level level) {
+	switch (level) {
+	case SIMD_AVX2: return "avx2";
+	case SIMD_SSE: return "sse";
+	default: return "scalar";
+	}
+}
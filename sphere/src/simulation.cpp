@@ -0,0 +1,127 @@
+#include <math.h>
+#include "../header/simulation.h"
+
+#define INSTANCE_GRAIN 256 //instances per parallel_for chunk
+
+simulation::simulation(const camera& start_camera, const std::vector<glm::vec3>& instance_directions, float shell_radius, float spin, thread_pool* pool)
+	: state_camera(start_camera), directions(instance_directions), shell_radius(shell_radius), spin(spin), pool(pool), running(false) {
+	simulation_snapshot first;
+
+	last.camera_position = state_camera.position;
+	last.yaw = state_camera.yaw;
+	last.pitch = state_camera.pitch;
+	last.instance_positions.resize(directions.size());
+	for (size_t i = 0; i < directions.size(); i++)
+		last.instance_positions[i] = directions[i] * shell_radius;
+	first.previous = last;
+	first.current = last;
+	snapshots.reset(first);
+}
+simulation::~simulation() {
+	stop();
+}
+
+void simulation::start() {
+	if (running)
+		return;
+	start_time = simulation_clock::now();
+	running = true;
+	worker = std::thread(&simulation::run, this);
+}
+void simulation::stop() {
+	running = false;
+	if (worker.joinable())
+		worker.join();
+}
+
+void simulation::set_input(const simulation_input& input) {
+	inputs.back() = input;
+	inputs.publish();
+}
+
+//Sleeps until each tick is due; after a long stall at most SIMULATION_MAX_CATCH_UP ticks are replayed
+void simulation::run() {
+	const simulation_clock::duration tick = std::chrono::duration_cast<simulation_clock::duration>(std::chrono::duration<double>(1.0 / SIMULATION_HZ));
+	simulation_clock::time_point due = start_time + tick;
+	uint64_t ticks = 0;
+
+	while (running) {
+		std::this_thread::sleep_until(due);
+		for (int caught_up = 0; simulation_clock::now() >= due && caught_up < SIMULATION_MAX_CATCH_UP; caught_up++) {
+			ticks++;
+			step(double(ticks) / SIMULATION_HZ);
+			due += tick;
+		}
+		if (simulation_clock::now() >= due) {
+			ticks += uint64_t((simulation_clock::now() - due) / tick) + 1;
+			due = start_time + tick * (ticks + 1);
+		}
+	}
+}
+
+void simulation::step(double time) {
+	float delta_time = 1.0f / SIMULATION_HZ;
+	simulation_snapshot& snapshot = snapshots.back();
+
+	if (inputs.acquire()) {
+		const simulation_input& input = inputs.front();
+		state_camera.process_mouse(input.mouse_x - applied_input.mouse_x, input.mouse_y - applied_input.mouse_y);
+		applied_input = input;
+	}
+	if (applied_input.keys & SIMULATION_KEY_FORWARD)
+		state_camera.process_keyboard(FORWARD, delta_time);
+	if (applied_input.keys & SIMULATION_KEY_BACKWARD)
+		state_camera.process_keyboard(BACKWARD, delta_time);
+	if (applied_input.keys & SIMULATION_KEY_LEFT)
+		state_camera.process_keyboard(LEFT, delta_time);
+	if (applied_input.keys & SIMULATION_KEY_RIGHT)
+		state_camera.process_keyboard(RIGHT, delta_time);
+
+	snapshot.previous = last;
+	last.tick++;
+	last.time = time;
+	last.camera_position = state_camera.position;
+	last.yaw = state_camera.yaw;
+	last.pitch = state_camera.pitch;
+
+	//the shell turns about y; each chunk writes its own range, so the pool needs no locking
+	float angle = spin * float(time), spin_cos = cosf(angle), spin_sin = sinf(angle);
+	glm::vec3* positions = last.instance_positions.data();
+	const glm::vec3* from = directions.data();
+	float radius = shell_radius;
+	auto turn = [positions, from, radius, spin_cos, spin_sin](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+			positions[i] = glm::vec3(spin_cos * from[i].x + spin_sin * from[i].z, from[i].y, spin_cos * from[i].z - spin_sin * from[i].x) * radius;
+	};
+	if (pool)
+		pool->parallel_for(directions.size(), INSTANCE_GRAIN, turn);
+	else
+		turn(0, directions.size());
+
+	snapshot.current = last;
+	snapshots.publish();
+}
+
+bool simulation::sample(camera* view, std::vector<glm::vec3>* instance_positions) {
+	double now = std::chrono::duration<double>(simulation_clock::now() - start_time).count();
+	snapshots.acquire();
+	const simulation_snapshot& snapshot = snapshots.front();
+	const simulation_frame& from = snapshot.previous;
+	const simulation_frame& to = snapshot.current;
+
+	if (to.tick == 0) {
+		view->position = to.camera_position;
+		view->set_orientation(to.yaw, to.pitch);
+		*instance_positions = to.instance_positions;
+		return false;
+	}
+	float blend = float((now - to.time) * SIMULATION_HZ);
+	blend = blend < 0.0f ? 0.0f : (blend > 1.0f ? 1.0f : blend);
+
+	view->position = glm::mix(from.camera_position, to.camera_position, blend);
+	view->set_orientation(from.yaw + (to.yaw - from.yaw) * blend, from.pitch + (to.pitch - from.pitch) * blend);
+	instance_positions->resize(to.instance_positions.size());
+	for (size_t i = 0; i < to.instance_positions.size(); i++)
+		(*instance_positions)[i] = glm::mix(from.instance_positions[i], to.instance_positions[i], blend);
+	return true;
+}
@@ -0,0 +1,98 @@
+#include "../header/sphere_adjacency.h"
+#include "../header/sphere_mesh.h"
+#include "../header/thread_pool.h"
+
+#define ADJACENCY_GRAIN 4096 //vertices per parallel_for chunk
+
+/* Diagram of ring assembly around vertex a
+	each triangle (a, b, c) is counter-clockwise from outside, so it contributes the step b -> c around a;
+	following the steps from any start visits the whole closed ring in counter-clockwise order
+*/
+void build_sphere_adjacency(const std::vector<GLuint>& indices, size_t vertex_count, sphere_adjacency* adjacency, thread_pool* pool) {
+	std::vector<uint32_t> steps; //per vertex ring slots holding (from, to) pairs until they are chained
+	std::vector<uint32_t> fill;
+
+	//on a closed mesh a vertex has as many neighbors as incident triangles
+	adjacency->offsets.assign(vertex_count + 1, 0);
+	for (size_t i = 0; i < indices.size(); i++)
+		adjacency->offsets[indices[i] + 1]++;
+	for (size_t v = 0; v < vertex_count; v++)
+		adjacency->offsets[v + 1] += adjacency->offsets[v];
+
+	steps.resize(2 * indices.size());
+	fill.assign(adjacency->offsets.begin(), adjacency->offsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		for (int corner = 0; corner < 3; corner++) {
+			uint32_t a = indices[i + corner], b = indices[i + (corner + 1) % 3], c = indices[i + (corner + 2) % 3];
+			uint32_t slot = fill[a]++;
+			steps[2 * slot] = b;
+			steps[2 * slot + 1] = c;
+		}
+	}
+
+	adjacency->neighbors.resize(indices.size());
+	auto chain = [adjacency, &steps](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++) {
+			uint32_t first = adjacency->offsets[v], count = adjacency->offsets[v + 1] - first;
+			const uint32_t* pairs = steps.data() + 2 * first;
+			uint32_t* ring = adjacency->neighbors.data() + first;
+			if (count == 0)
+				continue;
+
+			//valence is 4 or 6, so a linear search for the next step beats any map
+			ring[0] = pairs[0];
+			for (uint32_t k = 1; k < count; k++) {
+				uint32_t j = 0;
+				while (j < count && pairs[2 * j] != ring[k - 1])
+					j++;
+				ring[k] = j < count ? pairs[2 * j + 1] : pairs[2 * k];
+			}
+		}
+	};
+	if (pool)
+		pool->parallel_for(vertex_count, ADJACENCY_GRAIN, chain);
+	else
+		chain(0, vertex_count);
+}
+
+void generate_sphere_adjacency(sphere_mesh* mesh, thread_pool* pool) {
+	build_sphere_adjacency(mesh->indices, mesh->positions.size(), &mesh->adjacency, pool);
+}
+
+sphere_cell locate_sphere_cell(const glm::vec3& direction, int level) {
+	int n = sphere_divisions(level), points[3][3];
+	float row_f, col_f;
+	glm::vec2 corner[3];
+	sphere_cell cell;
+
+	sphere_lattice_locate(direction.x, direction.y, direction.z, n, &cell.face, &cell.row, &cell.column, &row_f, &col_f);
+	cell.triangle = uint32_t(sphere_row_offset(cell.face, cell.row, n) + cell.column);
+	sphere_face_triangle_points(cell.face, cell.row, cell.column, n, points);
+	for (int i = 0; i < 3; i++) {
+		cell.vertices[i] = sphere_lattice_index(points[i][0], points[i][1], points[i][2], n);
+		corner[i] = glm::vec2(float(n - abs(points[i][1])), float(abs(points[i][2])));
+	}
+
+	//barycentric weights of (row_f, col_f) in the flat lattice triangle
+	glm::vec2 e1 = corner[1] - corner[0], e2 = corner[2] - corner[0], p = glm::vec2(row_f, col_f) - corner[0];
+	float determinant = e1.x * e2.y - e1.y * e2.x;
+	float w1 = (p.x * e2.y - p.y * e2.x) / determinant, w2 = (e1.x * p.y - e1.y * p.x) / determinant;
+	cell.weights = glm::vec3(1.0f - w1 - w2, w1, w2);
+	return cell;
+}
+
+void diffuse_sphere_field(const sphere_adjacency& adjacency, const float* in, float* out, float rate, thread_pool* pool) {
+	auto step = [&adjacency, in, out, rate](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++) {
+			uint32_t first = adjacency.offsets[v], last = adjacency.offsets[v + 1];
+			float sum = 0.0f;
+			for (uint32_t k = first; k < last; k++)
+				sum += in[adjacency.neighbors[k]];
+			out[v] = last > first ? in[v] + rate * (sum / float(last - first) - in[v]) : in[v];
+		}
+	};
+	if (pool)
+		pool->parallel_for(adjacency.vertex_count(), ADJACENCY_GRAIN, step);
+	else
+		step(0, adjacency.vertex_count());
+}
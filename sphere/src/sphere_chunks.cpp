@@ -0,0 +1,410 @@
+#include <math.h>
+#include <thread>
+#include <glm/gtc/matrix_transform.hpp>
+#include "../header/sphere_chunks.h"
+#include "../header/shader.h"
+#include "../header/profiler.h"
+
+#define CHUNK_SKIRT 0.5 //skirt depth in triangle edges; covers the gap to a neighbor one level coarser
+#define CHUNK_CONE_MARGIN 0.01 //radians added to each normal cone; skirts bend away from the surface
+
+/*----- Chunk keys -----*/
+chunk_key make_chunk_key(int face) {
+	return chunk_key(face & 7);
+}
+chunk_key chunk_child(chunk_key key, int child) {
+	int depth = chunk_depth(key);
+	return (key & ~chunk_key(0xF8)) | (chunk_key(depth + 1) << 3) | (chunk_key(child & 3) << (8 + 2 * depth));
+}
+int chunk_face(chunk_key key) {
+	return int(key & 7);
+}
+int chunk_depth(chunk_key key) {
+	return int((key >> 3) & 31);
+}
+
+static void child_corners(const glm::dvec3 parent[3], int child, glm::dvec3 out[3]) {
+	glm::dvec3 ab = 0.5 * (parent[0] + parent[1]), bc = 0.5 * (parent[1] + parent[2]), ca = 0.5 * (parent[2] + parent[0]);
+	switch (child) {
+	case 0: out[0] = parent[0]; out[1] = ab; out[2] = ca; break;
+	case 1: out[0] = ab; out[1] = parent[1]; out[2] = bc; break;
+	case 2: out[0] = ca; out[1] = bc; out[2] = parent[2]; break;
+	default: out[0] = ab; out[1] = bc; out[2] = ca; break; //turned upside down, so the winding is kept
+	}
+}
+
+//Pole, then the z and x axis corners; mirrored faces swap the last two so every root winds the same way
+void chunk_corners(chunk_key key, glm::dvec3 corners[3]) {
+	const int* signs = sphere_face_signs[chunk_face(key)];
+	bool mirrored = signs[0] * signs[1] * signs[2] < 0;
+	glm::dvec3 pole(0.0, signs[1], 0.0), z_axis(0.0, 0.0, signs[2]), x_axis(signs[0], 0.0, 0.0);
+
+	corners[0] = pole;
+	corners[1] = mirrored ? x_axis : z_axis;
+	corners[2] = mirrored ? z_axis : x_axis;
+	for (int level = 0; level < chunk_depth(key); level++) {
+		glm::dvec3 parent[3] = { corners[0], corners[1], corners[2] };
+		child_corners(parent, int((key >> (8 + 2 * level)) & 3), corners);
+	}
+}
+
+/*----- Chunk mesh -----*/
+/* Diagram of chunk vertices, CHUNK_DIVISIONS = 2
+	row 0         a				vertex (i, j) = a + (b - a) * i / N + (c - b) * j / N
+	row 1       (1,0)(1,1)		sits at i * (i + 1) / 2 + j; skirts follow, one vertex per edge vertex,
+	row 2     b  (2,1)  c		walking the edges a -> b -> c -> a
+*/
+static size_t chunk_vertex(int i, int j) {
+	return size_t(i) * (i + 1) / 2 + j;
+}
+
+//Edge vertices in counter-clockwise order around the chunk, N + 1 per edge, corners repeated
+static void chunk_edge(int edge, int k, int* i, int* j) {
+	switch (edge) {
+	case 0: *i = k; *j = 0; break;
+	case 1: *i = CHUNK_DIVISIONS; *j = k; break;
+	default: *i = CHUNK_DIVISIONS - k; *j = CHUNK_DIVISIONS - k; break;
+	}
+}
+
+size_t chunk_vertex_count() {
+	return chunk_vertex(CHUNK_DIVISIONS + 1, 0) + 3 * (CHUNK_DIVISIONS + 1);
+}
+size_t chunk_index_count() {
+	return 3 * size_t(CHUNK_DIVISIONS) * CHUNK_DIVISIONS + 3 * 6 * size_t(CHUNK_DIVISIONS);
+}
+
+//Topology is the same for every chunk, so it is built once
+static const std::vector<GLuint>& chunk_indices() {
+	static const std::vector<GLuint> indices = [] {
+		std::vector<GLuint> out;
+		size_t skirt = chunk_vertex(CHUNK_DIVISIONS + 1, 0);
+
+		out.reserve(chunk_index_count());
+		for (int i = 0; i < CHUNK_DIVISIONS; i++) {
+			for (int j = 0; j <= i; j++) {
+				out.push_back(GLuint(chunk_vertex(i, j)));
+				out.push_back(GLuint(chunk_vertex(i + 1, j)));
+				out.push_back(GLuint(chunk_vertex(i + 1, j + 1)));
+				if (j < i) {
+					out.push_back(GLuint(chunk_vertex(i, j)));
+					out.push_back(GLuint(chunk_vertex(i + 1, j + 1)));
+					out.push_back(GLuint(chunk_vertex(i, j + 1)));
+				}
+			}
+		}
+		//walls face away from the chunk: the edges run counter-clockwise, so outwards is to their right
+		for (int edge = 0; edge < 3; edge++) {
+			for (int k = 0; k < CHUNK_DIVISIONS; k++) {
+				int i0, j0, i1, j1;
+				GLuint s0 = GLuint(skirt + edge * (CHUNK_DIVISIONS + 1) + k);
+				chunk_edge(edge, k, &i0, &j0);
+				chunk_edge(edge, k + 1, &i1, &j1);
+				out.push_back(GLuint(chunk_vertex(i0, j0)));
+				out.push_back(s0);
+				out.push_back(GLuint(chunk_vertex(i1, j1)));
+				out.push_back(GLuint(chunk_vertex(i1, j1)));
+				out.push_back(s0);
+				out.push_back(s0 + 1);
+			}
+		}
+		return out;
+	}();
+	return indices;
+}
+
+void generate_chunk_mesh(sphere_mesh* mesh, chunk_key key, double radius, glm::dvec3* origin) {
+	glm::dvec3 corners[3];
+	size_t skirt = chunk_vertex(CHUNK_DIVISIONS + 1, 0);
+	double skirt_depth;
+
+	chunk_corners(key, corners);
+	*origin = glm::normalize(corners[0] + corners[1] + corners[2]) * radius;
+	skirt_depth = CHUNK_SKIRT * glm::length(glm::normalize(corners[0]) - glm::normalize(corners[1])) * radius / CHUNK_DIVISIONS;
+
+	mesh->level = chunk_depth(key) + int(log2(double(CHUNK_DIVISIONS)) + 0.5);
+	mesh->radius = radius;
+	mesh->positions.resize(chunk_vertex_count());
+	mesh->normals.resize(chunk_vertex_count());
+	mesh->colors.resize(chunk_vertex_count());
+	for (int i = 0; i <= CHUNK_DIVISIONS; i++) {
+		for (int j = 0; j <= i; j++) {
+			glm::dvec3 flat = corners[0] + (corners[1] - corners[0]) * (double(i) / CHUNK_DIVISIONS) + (corners[2] - corners[1]) * (double(j) / CHUNK_DIVISIONS);
+			glm::dvec3 direction = glm::normalize(flat);
+			size_t v = chunk_vertex(i, j);
+			mesh->positions[v] = glm::vec3(direction * radius - *origin);
+			mesh->normals[v] = glm::vec3(direction);
+			mesh->colors[v] = sphere_vertex_color(v);
+		}
+	}
+	for (int edge = 0; edge < 3; edge++) {
+		for (int k = 0; k <= CHUNK_DIVISIONS; k++) {
+			int i, j;
+			chunk_edge(edge, k, &i, &j);
+			size_t v = chunk_vertex(i, j), s = skirt + edge * (CHUNK_DIVISIONS + 1) + k;
+			glm::dvec3 direction(mesh->normals[v]);
+			mesh->positions[s] = glm::vec3(glm::normalize(direction) * (radius - skirt_depth) - *origin);
+			mesh->normals[s] = mesh->normals[v];
+			mesh->colors[s] = mesh->colors[v];
+		}
+	}
+	mesh->indices = chunk_indices();
+	mesh->morph_targets.clear();
+	mesh->patches.clear();
+}
+
+/*----- Sphere chunks -----*/
+sphere_chunks::sphere_chunks(double radius, thread_pool* pool, int max_depth, size_t budget_bytes)
+	: target_edge_pixels(CHUNK_TARGET_EDGE_PIXELS), budget_bytes(budget_bytes), radius(radius),
+	max_depth(max_depth < CHUNK_DEPTH_LIMIT ? max_depth : CHUNK_DEPTH_LIMIT), pool(pool), frame(0), resident_bytes(0),
+	generated(0), evicted(0), last_drawn_count(0), last_triangles(0) {
+	pending_loads = 0;
+	//enough to keep every worker busy while the walk asks coarse chunks first
+	max_in_flight = 4 * size_t(pool ? pool->size() : 1);
+	chunk_bytes = make_vertex_layout(VERTEX_LAYOUT_PLANAR_PCN).buffer_size(chunk_vertex_count()) + chunk_index_count() * sizeof(GLushort);
+	for (int face = 0; face < 8; face++)
+		request(make_chunk_key(face));
+}
+sphere_chunks::~sphere_chunks() {
+	while (pending_loads.load() > 0)
+		std::this_thread::yield();
+}
+
+void sphere_chunks::request(chunk_key key) {
+	if (entries.count(key) || (in_flight.size() >= max_in_flight && chunk_depth(key) > 0))
+		return;
+
+	chunk_entry& entry = entries[key];
+	entry.state = CHUNK_LOADING;
+	entry.bytes = 0;
+	entry.last_drawn = frame;
+	in_flight.push_back(key);
+	pending_loads++;
+
+	chunk_entry* target = &entry;
+	double sphere_radius = radius;
+	auto load = [this, target, key, sphere_radius] {
+		PROFILE_ZONE("chunk_generate");
+		generate_chunk_mesh(&target->mesh, key, sphere_radius, &target->origin);
+		target->state.store(CHUNK_LOADED, std::memory_order_release);
+		pending_loads--;
+	};
+	if (pool)
+		pool->submit(load);
+	else
+		load();
+}
+
+bool sphere_chunks::resident(chunk_key key) {
+	std::unordered_map<chunk_key, chunk_entry>::iterator found = entries.find(key);
+	return found != entries.end() && found->second.state.load(std::memory_order_acquire) == CHUNK_RESIDENT;
+}
+
+bool sphere_chunks::ready() const {
+	for (int face = 0; face < 8; face++) {
+		std::unordered_map<chunk_key, chunk_entry>::const_iterator found = entries.find(make_chunk_key(face));
+		if (found == entries.end() || found->second.state.load(std::memory_order_acquire) != CHUNK_RESIDENT)
+			return false;
+	}
+	return true;
+}
+
+void sphere_chunks::update(GLuint program_ID) {
+	PROFILE_ZONE("chunk_update");
+	int uploads = 0;
+
+	for (size_t i = 0; i < in_flight.size() && uploads < CHUNK_UPLOADS_PER_FRAME;) {
+		chunk_entry& entry = entries[in_flight[i]];
+		if (entry.state.load(std::memory_order_acquire) != CHUNK_LOADED) {
+			i++;
+			continue;
+		}
+
+		//positions are small offsets from the origin, which the 16-bit float compact layouts would round away
+		entry.buffer.layout = VERTEX_LAYOUT_PLANAR_PCN;
+		entry.buffer.upload(entry.mesh, program_ID);
+		entry.bytes = chunk_bytes;
+		entry.mesh = sphere_mesh();
+		entry.state = CHUNK_RESIDENT;
+		resident_bytes += entry.bytes;
+		generated++;
+		if (chunk_depth(in_flight[i]) > 0) {
+			lru.push_front(in_flight[i]);
+			entry.lru = lru.begin();
+		}
+		in_flight[i] = in_flight.back();
+		in_flight.pop_back();
+		uploads++;
+	}
+	evict();
+}
+
+//A chunk with resident children goes after them; without it the walk would stop there and drop the children anyway
+bool sphere_chunks::has_resident_children(chunk_key key) {
+	if (chunk_depth(key) >= CHUNK_DEPTH_LIMIT)
+		return false;
+	for (int child = 0; child < 4; child++) {
+		if (resident(chunk_child(key, child)))
+			return true;
+	}
+	return false;
+}
+
+//Oldest first; chunks visited this frame stay even past the budget, since they would only be asked for again.
+//Stale chunks go a split's worth below the budget, so they never hold off the children the view needs.
+void sphere_chunks::evict() {
+	size_t reserve = 4 * chunk_bytes < budget_bytes ? 4 * chunk_bytes : 0;
+	std::list<chunk_key>::iterator it = lru.end();
+	while (resident_bytes + reserve > budget_bytes && it != lru.begin()) {
+		--it;
+		chunk_key key = *it;
+		chunk_entry& entry = entries[key];
+		if (entry.last_drawn >= frame)
+			break;
+		if (has_resident_children(key))
+			continue;
+		entry.buffer.release();
+		resident_bytes -= entry.bytes;
+		it = lru.erase(it);
+		entries.erase(key);
+		evicted++;
+	}
+}
+
+/* Diagram of chunk bounds
+	every direction in the chunk is within angle t of axis, the normalized sum of the corner directions,
+	so the surface lies on the cap of that cone: bounding sphere center axis * r * cos(t), radius r * sin(t).
+	Normals are the directions themselves, which gives the normal cone for back face culling directly.
+*/
+sphere_patch sphere_chunks::bounds(const glm::dvec3 corners[3]) const {
+	glm::dvec3 directions[3] = { glm::normalize(corners[0]), glm::normalize(corners[1]), glm::normalize(corners[2]) };
+	glm::dvec3 axis = glm::normalize(directions[0] + directions[1] + directions[2]);
+	double min_cos = 1.0, angle, skirt_depth;
+	sphere_patch patch;
+
+	for (int i = 0; i < 3; i++)
+		min_cos = fmin(min_cos, glm::dot(axis, directions[i]));
+	angle = acos(min_cos);
+	skirt_depth = CHUNK_SKIRT * glm::length(directions[0] - directions[1]) * radius / CHUNK_DIVISIONS;
+
+	patch.center = glm::vec3(axis * (radius * min_cos));
+	patch.radius = float(radius * sin(angle) + skirt_depth);
+	patch.cone_axis = glm::vec3(axis);
+	angle += CHUNK_CONE_MARGIN;
+	patch.cone_sin = float(sin(angle));
+	patch.cone_cos = float(cos(angle));
+	patch.first_index = 0;
+	patch.index_count = 0;
+	patch.reserved = 0;
+	return patch;
+}
+
+void sphere_chunks::walk(chunk_key key, const glm::dvec3 corners[3], const view_frustum& frustum, const glm::vec3& eye, float pixel_scale) {
+	sphere_patch patch = bounds(corners);
+	glm::dvec3 children[4][3];
+	chunk_key missing[4];
+	int missing_count = 0;
+	bool split = true;
+
+	if (!patch_visible(patch, frustum, eye))
+		return;
+	if (!resident(key)) {
+		request(key);
+		return;
+	}
+	//split parents count as used too, or they age out under their drawn children and take the subtree with them
+	chunk_entry& entry = entries[key];
+	entry.last_drawn = frame;
+
+	//projected length of one triangle edge at the nearest point of the bounds
+	float distance = fmaxf(glm::length(eye - patch.center) - patch.radius, float(radius) * 1e-7f);
+	float edge = float(glm::length(glm::normalize(corners[0]) - glm::normalize(corners[1])) * radius) / CHUNK_DIVISIONS;
+	if (chunk_depth(key) >= max_depth || edge * pixel_scale / distance <= target_edge_pixels)
+		split = false;
+
+	//only split once every visible child can be drawn, so the surface never has holes while children load;
+	//children that would not fit in the budget are not asked for, or they would only be evicted again
+	for (int child = 0; child < 4 && split; child++)
+		child_corners(corners, child, children[child]);
+	for (int child = 0; child < 4 && split; child++) {
+		if (!patch_visible(bounds(children[child]), frustum, eye))
+			continue;
+		chunk_key child_key = chunk_child(key, child);
+		if (resident(child_key)) { //wanted even while a sibling loads
+			chunk_entry& wanted = entries[child_key];
+			wanted.last_drawn = frame;
+			lru.splice(lru.begin(), lru, wanted.lru);
+		}
+		else
+			missing[missing_count++] = child_key;
+	}
+	if (missing_count > 0) {
+		if (resident_bytes + (in_flight.size() + missing_count) * chunk_bytes <= budget_bytes) {
+			for (int i = 0; i < missing_count; i++)
+				request(missing[i]);
+		}
+		split = false;
+	}
+
+	if (split) {
+		for (int child = 0; child < 4; child++)
+			walk(chunk_child(key, child), children[child], frustum, eye, pixel_scale);
+	}
+	//moved to the front after its children, so among chunks of one frame the children sit nearer the back
+	if (chunk_depth(key) > 0)
+		lru.splice(lru.begin(), lru, entry.lru);
+	if (!split)
+		visible.push_back(&entry);
+}
+
+uint64_t sphere_chunks::draw(shader_program* program, const glm::mat4& model, const view_frustum& frustum, const glm::vec3& eye, float fov_y, float viewport_height) {
+	PROFILE_ZONE("chunk_draw");
+	float pixel_scale = 0.5f * viewport_height / tanf(0.5f * fov_y);
+	size_t surface_indices = 3 * size_t(CHUNK_DIVISIONS) * CHUNK_DIVISIONS;
+
+	frame++;
+	visible.clear();
+	for (int face = 0; face < 8; face++) {
+		glm::dvec3 corners[3];
+		chunk_corners(make_chunk_key(face), corners);
+		walk(make_chunk_key(face), corners, frustum, eye, pixel_scale);
+	}
+
+	for (size_t i = 0; i < visible.size(); i++) {
+		program->set_mat4("model", glm::translate(model, glm::vec3(visible[i]->origin)));
+		visible[i]->buffer.draw();
+	}
+	program->set_mat4("model", model); //later draws with the same program expect the model they set
+	last_drawn_count = visible.size();
+	last_triangles = uint64_t(visible.size()) * (surface_indices / 3);
+	return last_triangles;
+}
+
+chunk_stats sphere_chunks::stats() const {
+	chunk_stats result;
+	result.resident = lru.size();
+	for (int face = 0; face < 8; face++) {
+		std::unordered_map<chunk_key, chunk_entry>::const_iterator found = entries.find(make_chunk_key(face));
+		if (found != entries.end() && found->second.state.load() == CHUNK_RESIDENT)
+			result.resident++;
+	}
+	result.in_flight = in_flight.size();
+	result.drawn = last_drawn_count;
+	result.triangles = last_triangles;
+	result.resident_bytes = resident_bytes;
+	result.generated = generated;
+	result.evicted = evicted;
+	return result;
+}
+
+void sphere_chunks::release() {
+	while (pending_loads.load() > 0)
+		std::this_thread::yield();
+	for (std::unordered_map<chunk_key, chunk_entry>::iterator it = entries.begin(); it != entries.end(); ++it)
+		it->second.buffer.release();
+	entries.clear();
+	lru.clear();
+	in_flight.clear();
+	visible.clear();
+	resident_bytes = 0;
+}
@@ -0,0 +1,234 @@
+#include <algorithm>
+#include "../header/sphere_displacement.h"
+#include "../header/sphere_mesh.h"
+#include "../header/profiler.h"
+
+#define NO_PATCH uint32_t(-1)
+
+static void run_parallel(thread_pool* pool, size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+	if (pool)
+		pool->parallel_for(count, grain, body);
+	else
+		body(0, count);
+}
+
+sphere_displacement::sphere_displacement(sphere_mesh* mesh, const displacement_params& params, thread_pool* pool) : mesh(mesh) {
+	size_t vertex_count = mesh->positions.size(), patch_count = mesh->patches.empty() ? 1 : mesh->patches.size();
+	std::vector<uint32_t> owners(vertex_count, NO_PATCH);
+
+	if (mesh->adjacency.vertex_count() != vertex_count)
+		generate_sphere_adjacency(mesh, pool);
+	directions.resize(vertex_count);
+	for (size_t v = 0; v < vertex_count; v++)
+		directions[v] = glm::normalize(mesh->positions[v]);
+	if (mesh->morph_targets.size() == vertex_count)
+		find_morph_parents();
+
+	//first patch to use a vertex owns it; vertices no triangle uses go to the first patch
+	for (size_t p = 0; p < mesh->patches.size(); p++) {
+		const GLuint* indices = mesh->indices.data() + mesh->patches[p].first_index;
+		for (uint32_t i = 0; i < mesh->patches[p].index_count; i++) {
+			if (owners[indices[i]] == NO_PATCH)
+				owners[indices[i]] = uint32_t(p);
+		}
+	}
+	owned_offsets.assign(patch_count + 1, 0);
+	for (size_t v = 0; v < vertex_count; v++) {
+		if (owners[v] == NO_PATCH)
+			owners[v] = 0;
+		owned_offsets[owners[v] + 1]++;
+	}
+	for (size_t p = 0; p < patch_count; p++)
+		owned_offsets[p + 1] += owned_offsets[p];
+	owned.resize(vertex_count);
+	{
+		std::vector<uint32_t> fill(owned_offsets.begin(), owned_offsets.end() - 1);
+		for (size_t v = 0; v < vertex_count; v++)
+			owned[fill[owners[v]]++] = uint32_t(v);
+	}
+
+	find_users();
+	this->params.assign(patch_count, params);
+	dirty.assign(patch_count, 1);
+	stale.assign(patch_count, 0);
+	marks.assign(vertex_count, 0);
+}
+
+//Most vertices sit inside one patch; those on patch borders are listed once per patch using them
+void sphere_displacement::find_users() {
+	size_t vertex_count = mesh->positions.size();
+	std::vector<uint32_t> last(vertex_count, NO_PATCH);
+
+	user_offsets.assign(vertex_count + 1, 0);
+	users.clear();
+	if (mesh->patches.empty())
+		return;
+	for (int pass = 0; pass < 2; pass++) {
+		std::vector<uint32_t> fill(user_offsets.begin(), user_offsets.end() - 1);
+		last.assign(vertex_count, NO_PATCH);
+		for (size_t p = 0; p < mesh->patches.size(); p++) {
+			const GLuint* indices = mesh->indices.data() + mesh->patches[p].first_index;
+			for (uint32_t i = 0; i < mesh->patches[p].index_count; i++) {
+				GLuint vertex = indices[i];
+				if (last[vertex] == uint32_t(p))
+					continue;
+				last[vertex] = uint32_t(p);
+				if (pass == 0)
+					user_offsets[vertex + 1]++;
+				else
+					users[fill[vertex]++] = uint32_t(p);
+			}
+		}
+		if (pass == 0) {
+			for (size_t v = 0; v < vertex_count; v++)
+				user_offsets[v + 1] += user_offsets[v];
+			users.resize(user_offsets[vertex_count]);
+		}
+	}
+}
+
+//Same edge split as generate_morph_targets (sphere_morph_parents), resolved to the two fine vertices at the ends of the coarse edge
+void sphere_displacement::find_morph_parents() {
+	int n = sphere_divisions(mesh->level);
+	auto slot = [this](size_t lattice) { return uint32_t(mesh->vertex_remap.empty() ? lattice : mesh->vertex_remap[lattice]); };
+
+	morph_parents.resize(2 * mesh->positions.size());
+	for (int y = n; y >= -n; y--) {
+		size_t offset = sphere_ring_offset(y, n);
+		for (size_t p = 0; p < sphere_ring_size(y, n); p++) {
+			int lattice[3] = { 0, y, 0 }, a[3] = {}, b[3] = {};
+			uint32_t vertex = slot(offset + p);
+
+			sphere_ring_point(y, n, p, &lattice[0], &lattice[2]);
+			morph_parents[2 * vertex] = morph_parents[2 * vertex + 1] = vertex;
+			if (n == 1 || !sphere_morph_parents(lattice[0], lattice[1], lattice[2], a, b))
+				continue;
+			morph_parents[2 * vertex] = slot(sphere_lattice_index(a[0], a[1], a[2], n));
+			morph_parents[2 * vertex + 1] = slot(sphere_lattice_index(b[0], b[1], b[2], n));
+		}
+	}
+}
+
+size_t sphere_displacement::patch_count() const {
+	return params.size();
+}
+const displacement_params& sphere_displacement::patch_params(size_t patch) const {
+	return params[patch];
+}
+void sphere_displacement::set_params(const displacement_params& params) {
+	this->params.assign(this->params.size(), params);
+	dirty.assign(dirty.size(), 1);
+}
+void sphere_displacement::set_patch_params(size_t patch, const displacement_params& params) {
+	this->params[patch] = params;
+	dirty[patch] = 1;
+}
+const std::vector<vertex_range>& sphere_displacement::changed() const {
+	return ranges;
+}
+
+//Directions are gathered into separate x, y, z arrays so the noise runs as one vectorized call per block
+void sphere_displacement::displace(const displacement_block& block) {
+	float x[DISPLACEMENT_BLOCK] = {}, y[DISPLACEMENT_BLOCK] = {}, z[DISPLACEMENT_BLOCK] = {}, heights[DISPLACEMENT_BLOCK];
+	const displacement_params& patch = params[block.patch];
+	size_t count = block.end - block.begin;
+	float radius = float(mesh->radius);
+
+	for (size_t i = 0; i < count; i++) {
+		const glm::vec3& direction = directions[owned[block.begin + i]];
+		x[i] = direction.x;
+		y[i] = direction.y;
+		z[i] = direction.z;
+	}
+	fractal_noise(x, y, z, count, patch.noise, heights);
+	for (size_t i = 0; i < count; i++) {
+		uint32_t vertex = owned[block.begin + i];
+		mesh->positions[vertex] = directions[vertex] * (radius * (1.0f + patch.amplitude * heights[i]));
+	}
+}
+
+/* Diagram of the smooth normal at p
+	  r2 ---- r1		sum of cross(r[k] - p, r[k + 1] - p) over the counter-clockwise ring: each term is
+	 /  \    /  \		twice the area-weighted normal of one incident triangle
+	r3 -- p ----- r0
+*/
+void sphere_displacement::refresh(uint32_t vertex) {
+	const glm::vec3 center = mesh->positions[vertex];
+	const uint32_t* ring = mesh->adjacency.ring(vertex);
+	uint32_t valence = mesh->adjacency.valence(vertex);
+	glm::vec3 sum(0.0f);
+
+	for (uint32_t k = 0; k < valence; k++)
+		sum += glm::cross(mesh->positions[ring[k]] - center, mesh->positions[ring[k + 1 < valence ? k + 1 : 0]] - center);
+	mesh->normals[vertex] = glm::length(sum) > 0.0f ? glm::normalize(sum) : directions[vertex];
+	if (!morph_parents.empty())
+		mesh->morph_targets[vertex] = 0.5f * (mesh->positions[morph_parents[2 * vertex]] + mesh->positions[morph_parents[2 * vertex + 1]]);
+}
+
+size_t sphere_displacement::update(thread_pool* pool) {
+	PROFILE_ZONE("displace");
+	blocks.clear();
+	touched.clear();
+	ranges.clear();
+	for (uint32_t p = 0; p < dirty.size(); p++) {
+		if (!dirty[p])
+			continue;
+		for (uint32_t begin = owned_offsets[p]; begin < owned_offsets[p + 1]; begin += DISPLACEMENT_BLOCK)
+			blocks.push_back({ p, begin, std::min(begin + DISPLACEMENT_BLOCK, owned_offsets[p + 1]) });
+		dirty[p] = 0;
+	}
+	if (blocks.empty())
+		return 0;
+
+	run_parallel(pool, blocks.size(), 1, [this](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; b++)
+			displace(blocks[b]);
+	});
+
+	//moved vertices change the normals and morph targets of their rings too
+	for (const displacement_block& block : blocks) {
+		for (uint32_t i = block.begin; i < block.end; i++) {
+			uint32_t vertex = owned[i];
+			const uint32_t* ring = mesh->adjacency.ring(vertex);
+			if (!marks[vertex]) {
+				marks[vertex] = 1;
+				touched.push_back(vertex);
+			}
+			for (uint32_t k = 0; k < mesh->adjacency.valence(vertex); k++) {
+				if (!marks[ring[k]]) {
+					marks[ring[k]] = 1;
+					touched.push_back(ring[k]);
+				}
+			}
+		}
+	}
+	std::sort(touched.begin(), touched.end());
+	run_parallel(pool, touched.size(), DISPLACEMENT_BLOCK, [this](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+			refresh(touched[i]);
+	});
+
+	//bounds cover positions and morph targets, so every patch using a touched vertex needs new ones
+	stale_patches.clear();
+	for (size_t i = 0; i < touched.size(); i++) {
+		uint32_t vertex = touched[i];
+		marks[vertex] = 0;
+		for (uint32_t k = user_offsets[vertex]; k < user_offsets[vertex + 1]; k++) {
+			if (!stale[users[k]]) {
+				stale[users[k]] = 1;
+				stale_patches.push_back(users[k]);
+			}
+		}
+		if (!ranges.empty() && touched[i] - (ranges.back().first + ranges.back().count) <= DISPLACEMENT_RANGE_GAP)
+			ranges.back().count = touched[i] + 1 - ranges.back().first;
+		else
+			ranges.push_back({ touched[i], 1 });
+	}
+	run_parallel(pool, stale_patches.size(), 1, [this](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			update_patch_bounds(*mesh, &mesh->patches[stale_patches[i]]);
+			stale[stale_patches[i]] = 0;
+		}
+	});
+	return touched.size();
+}
@@ -0,0 +1,98 @@
+#include <string.h>
+#include "../header/sphere_impostors.h"
+#include "../header/uniform_buffer.h"
+#include "../header/gl_state.h"
+#include "../header/profiler.h"
+
+//Locations fixed by layout qualifiers in impostor_vertex.glsl
+#define IMPOSTOR_POSITION_LOCATION 4
+#define IMPOSTOR_COLOR_LOCATION 5
+
+sphere_impostors::sphere_impostors(size_t capacity) : VAO(0), program(NULL), capacity(capacity > 0 ? capacity : 1), count(0), mapped_count(0) {}
+sphere_impostors::~sphere_impostors() {
+	release();
+}
+
+bool sphere_impostors::create() {
+	const char* shader_paths[2] = { "src/shader/impostor_vertex.glsl", "src/shader/impostor_fragment.glsl" };
+	const GLenum shader_types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+
+	//loaded without the blocking constructor, which would exit on a compile error; the reason is already printed
+	program = new shader_program();
+	program->bind_uniform_block("frame", FRAME_UNIFORM_BINDING);
+	program->load_async(shader_paths, shader_types, 2, NULL);
+	if (!program->wait()) {
+		release();
+		return false;
+	}
+
+	glGenVertexArrays(1, &VAO);
+	gl_state.bind_vertex_array(VAO);
+	glVertexAttribDivisor(IMPOSTOR_POSITION_LOCATION, 1);
+	glVertexAttribDivisor(IMPOSTOR_COLOR_LOCATION, 1);
+	glEnableVertexAttribArray(IMPOSTOR_POSITION_LOCATION);
+	glEnableVertexAttribArray(IMPOSTOR_COLOR_LOCATION);
+	gl_state.bind_vertex_array(0);
+	return true;
+}
+
+//Records the bound GL_ARRAY_BUFFER at offset in the VAO
+void sphere_impostors::point_attributes(GLintptr offset) {
+	gl_state.bind_vertex_array(VAO);
+	glVertexAttribPointer(IMPOSTOR_POSITION_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(sphere_instance), (void*)offset);
+	glVertexAttribPointer(IMPOSTOR_COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(sphere_instance), (void*)(offset + sizeof(glm::vec4)));
+	gl_state.bind_vertex_array(0);
+}
+
+sphere_instance* sphere_impostors::map(size_t count) {
+	//grow geometrically; GL keeps the old ring alive until the draws already issued from it are done
+	if (!stream || stream->region_size < count * sizeof(sphere_instance)) {
+		while (capacity < count)
+			capacity *= 2;
+		stream.reset(new streaming_buffer(capacity * sizeof(sphere_instance)));
+	}
+	mapped_count = count;
+	return (sphere_instance*)stream->map();
+}
+
+void sphere_impostors::unmap() {
+	GLintptr offset = stream->unmap();
+	glBindBuffer(GL_ARRAY_BUFFER, stream->VBO);
+	point_attributes(offset);
+	count = mapped_count;
+}
+
+void sphere_impostors::upload(const sphere_instance* instances, size_t count) {
+	PROFILE_ZONE("impostor_upload");
+	sphere_instance* region = map(count);
+	memcpy(region, instances, count * sizeof(sphere_instance));
+	unmap();
+}
+
+void sphere_impostors::draw() {
+	if (count == 0)
+		return;
+	gl_state.bind_vertex_array(VAO);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, GLsizei(count));
+	stream->fence();
+}
+
+size_t sphere_impostors::size() const {
+	return count;
+}
+
+void sphere_impostors::release() {
+	stream.reset();
+	if (VAO) {
+		glDeleteVertexArrays(1, &VAO);
+		gl_state.vertex_array_deleted(VAO);
+	}
+	VAO = 0;
+	count = 0;
+	if (program) {
+		glDeleteProgram(program->ID);
+		gl_state.program_deleted(program->ID);
+		delete program;
+		program = NULL;
+	}
+}
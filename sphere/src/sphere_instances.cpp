@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <string.h>
+#include "../header/sphere_instances.h"
+#include "../header/gl_state.h"
+
+sphere_instances::sphere_instances(size_t capacity, bool streaming)
+	: VBO(0), gpu_capacity(0), dirty_begin(0), dirty_end(0), streaming(streaming), position_location(-1), color_location(-1) {
+	instances.reserve(capacity);
+	handles.reserve(capacity);
+	slots.reserve(capacity);
+}
+
+instance_handle sphere_instances::add(const glm::vec3& position, float radius, const glm::vec4& color) {
+	instance_handle handle;
+	sphere_instance instance;
+	instance.position_radius = glm::vec4(position, radius);
+	instance.color = color;
+
+	if (!free_handles.empty()) {
+		handle = free_handles.back();
+		free_handles.pop_back();
+	}
+	else {
+		handle = instance_handle(slots.size());
+		slots.push_back(0);
+	}
+	slots[handle] = GLuint(instances.size());
+	instances.push_back(instance);
+	handles.push_back(handle);
+	mark_dirty(instances.size() - 1);
+	return handle;
+}
+//Stale or made-up handles are refused, since their slot now belongs to another instance or to none
+bool sphere_instances::valid(instance_handle handle) const {
+	if (handle < slots.size() && slots[handle] != INSTANCE_NO_SLOT)
+		return true;
+	fprintf(stderr, "Ignoring invalid instance handle %u\n", handle);
+	return false;
+}
+
+void sphere_instances::update(instance_handle handle, const glm::vec3& position, float radius) {
+	if (!valid(handle))
+		return;
+	GLuint slot = slots[handle];
+	instances[slot].position_radius = glm::vec4(position, radius);
+	mark_dirty(slot);
+}
+void sphere_instances::update_color(instance_handle handle, const glm::vec4& color) {
+	if (!valid(handle))
+		return;
+	GLuint slot = slots[handle];
+	instances[slot].color = color;
+	mark_dirty(slot);
+}
+void sphere_instances::remove(instance_handle handle) {
+	if (!valid(handle))
+		return;
+	GLuint slot = slots[handle];
+	size_t last = instances.size() - 1;
+
+	//move the last instance into the hole so the buffer stays packed
+	if (slot != last) {
+		instances[slot] = instances[last];
+		handles[slot] = handles[last];
+		slots[handles[slot]] = slot;
+		mark_dirty(slot);
+	}
+	instances.pop_back();
+	handles.pop_back();
+	slots[handle] = INSTANCE_NO_SLOT;
+	free_handles.push_back(handle);
+}
+size_t sphere_instances::size() const {
+	return instances.size();
+}
+
+void sphere_instances::mark_dirty(size_t slot) {
+	if (dirty_begin == dirty_end) {
+		dirty_begin = slot;
+		dirty_end = slot + 1;
+		return;
+	}
+	if (slot < dirty_begin)
+		dirty_begin = slot;
+	if (slot + 1 > dirty_end)
+		dirty_end = slot + 1;
+}
+
+void sphere_instances::attach(const mesh_buffer& mesh, GLuint program_ID) {
+	//divisor 1 advances these once per instance instead of once per vertex
+	position_location = glGetAttribLocation(program_ID, "iPositionRadius");
+	color_location = glGetAttribLocation(program_ID, "iColor");
+	if (position_location < 0 || color_location < 0) {
+		fprintf(stderr, "Program %u has no iPositionRadius/iColor inputs; instances will not be placed\n", program_ID);
+		return;
+	}
+	gl_state.bind_vertex_array(mesh.VAO);
+	glVertexAttribDivisor(position_location, 1);
+	glVertexAttribDivisor(color_location, 1);
+	glEnableVertexAttribArray(position_location);
+	glEnableVertexAttribArray(color_location);
+	gl_state.bind_vertex_array(0);
+
+	attached_VAOs.push_back(mesh.VAO);
+	if (!streaming) {
+		if (!VBO)
+			glGenBuffers(1, &VBO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		point_attributes(0);
+	}
+}
+
+//Records the bound GL_ARRAY_BUFFER at offset in every attached VAO
+void sphere_instances::point_attributes(GLintptr offset) {
+	for (size_t i = 0; i < attached_VAOs.size(); i++) {
+		gl_state.bind_vertex_array(attached_VAOs[i]);
+		glVertexAttribPointer(position_location, 4, GL_FLOAT, GL_FALSE, sizeof(sphere_instance), (void*)offset);
+		glVertexAttribPointer(color_location, 4, GL_FLOAT, GL_FALSE, sizeof(sphere_instance), (void*)(offset + sizeof(glm::vec4)));
+	}
+	gl_state.bind_vertex_array(0);
+}
+
+void sphere_instances::stream_upload() {
+	GLintptr offset;
+	void* region;
+
+	if (!stream || stream->region_size < instances.size() * sizeof(sphere_instance))
+		stream.reset(new streaming_buffer(instances.capacity() * sizeof(sphere_instance)));
+	region = stream->map();
+	memcpy(region, instances.data(), instances.size() * sizeof(sphere_instance));
+	offset = stream->unmap();
+	glBindBuffer(GL_ARRAY_BUFFER, stream->VBO);
+	point_attributes(offset);
+}
+
+void sphere_instances::upload() {
+	if (streaming) {
+		if (!instances.empty())
+			stream_upload();
+		return;
+	}
+	if (!VBO)
+		glGenBuffers(1, &VBO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+	//grow geometrically and resend everything; the old storage is orphaned rather than waited on
+	if (instances.size() > gpu_capacity) {
+		gpu_capacity = instances.capacity();
+		glBufferData(GL_ARRAY_BUFFER, gpu_capacity * sizeof(sphere_instance), NULL, GL_DYNAMIC_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(sphere_instance), instances.data());
+	}
+	else if (dirty_begin < dirty_end && dirty_begin < instances.size()) {
+		size_t end = dirty_end < instances.size() ? dirty_end : instances.size();
+		glBufferSubData(GL_ARRAY_BUFFER, dirty_begin * sizeof(sphere_instance), (end - dirty_begin) * sizeof(sphere_instance), instances.data() + dirty_begin);
+	}
+	dirty_begin = dirty_end = 0;
+}
+
+void sphere_instances::draw(const mesh_buffer& mesh) {
+	if (instances.empty())
+		return;
+	gl_state.bind_vertex_array(mesh.VAO);
+	glDrawElementsInstanced(GL_TRIANGLES, mesh.index_count, mesh.index_type, (void*)0, GLsizei(instances.size()));
+	if (stream)
+		stream->fence();
+}
+
+void sphere_instances::release() {
+	if (VBO)
+		glDeleteBuffers(1, &VBO);
+	VBO = 0;
+	gpu_capacity = 0;
+	stream.reset();
+	attached_VAOs.clear();
+}
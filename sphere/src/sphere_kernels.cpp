@@ -0,0 +1,402 @@
+#include <math.h>
+#include "../header/sphere_kernels.h"
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "kernels write glm::vec3 as packed floats");
+
+typedef void (*normalization_kernel)(const float*, const float*, const float*, size_t, float, glm::vec3*, glm::vec3*);
+typedef void (*ray_sphere_kernel)(const float* const*, const float* const*, size_t, float, float*, float*);
+typedef void (*noise_kernel)(const float*, const float*, const float*, size_t, const noise_params&, float*);
+
+#define NOISE_SCALE 0.9f //brings single octave gradient noise with diagonal gradients to about [-1, 1]
+
+static void normalization_scalar(const float* x, const float* y, const float* z, size_t count, float radius, glm::vec3* positions, glm::vec3* normals) {
+	for (size_t i = 0; i < count; i++) {
+		float inverse_length = 1.0f / sqrtf(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+		glm::vec3 normal(x[i] * inverse_length, y[i] * inverse_length, z[i] * inverse_length);
+		normals[i] = normal;
+		positions[i] = normal * radius;
+	}
+}
+
+#ifdef SIMD_X86
+/* Diagram of 4 lane x/y/z registers transposed into 12 interleaved floats
+	x: x0 x1 x2 x3		out + 0: x0 y0 z0 x1
+	y: y0 y1 y2 y3	->	out + 4: y1 z1 x2 y2
+	z: z0 z1 z2 z3		out + 8: z2 x3 y3 z3
+*/
+static inline void store_interleaved(float* out, __m128 x, __m128 y, __m128 z) {
+	__m128 xy_lo = _mm_unpacklo_ps(x, y), xy_hi = _mm_unpackhi_ps(x, y);
+	__m128 yz_lo = _mm_unpacklo_ps(y, z), yz_hi = _mm_unpackhi_ps(y, z);
+	__m128 zx_lo = _mm_unpacklo_ps(z, x), zx_hi = _mm_unpackhi_ps(z, x);
+	_mm_storeu_ps(out, _mm_shuffle_ps(xy_lo, zx_lo, _MM_SHUFFLE(3, 0, 1, 0)));
+	_mm_storeu_ps(out + 4, _mm_shuffle_ps(yz_lo, xy_hi, _MM_SHUFFLE(1, 0, 3, 2)));
+	_mm_storeu_ps(out + 8, _mm_shuffle_ps(zx_hi, yz_hi, _MM_SHUFFLE(3, 2, 3, 0)));
+}
+
+static void normalization_sse(const float* x, const float* y, const float* z, size_t count, float radius, glm::vec3* positions, glm::vec3* normals) {
+	const __m128 half = _mm_set1_ps(0.5f), three = _mm_set1_ps(3.0f), scale = _mm_set1_ps(radius);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+		__m128 length_sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+
+		//rsqrt estimate is good to ~12 bits; one Newton-Raphson step brings it to float precision
+		__m128 r = _mm_rsqrt_ps(length_sq);
+		r = _mm_mul_ps(_mm_mul_ps(half, r), _mm_sub_ps(three, _mm_mul_ps(_mm_mul_ps(length_sq, r), r)));
+
+		__m128 nx = _mm_mul_ps(vx, r), ny = _mm_mul_ps(vy, r), nz = _mm_mul_ps(vz, r);
+		store_interleaved((float*)(normals + i), nx, ny, nz);
+		store_interleaved((float*)(positions + i), _mm_mul_ps(nx, scale), _mm_mul_ps(ny, scale), _mm_mul_ps(nz, scale));
+	}
+	normalization_scalar(x + i, y + i, z + i, count - i, radius, positions + i, normals + i);
+}
+
+SIMD_TARGET_AVX2 static void normalization_avx2(const float* x, const float* y, const float* z, size_t count, float radius, glm::vec3* positions, glm::vec3* normals) {
+	const __m256 half = _mm256_set1_ps(0.5f), three = _mm256_set1_ps(3.0f), scale = _mm256_set1_ps(radius);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+		__m256 length_sq = _mm256_fmadd_ps(vz, vz, _mm256_fmadd_ps(vy, vy, _mm256_mul_ps(vx, vx)));
+
+		__m256 r = _mm256_rsqrt_ps(length_sq);
+		r = _mm256_mul_ps(_mm256_mul_ps(half, r), _mm256_fnmadd_ps(_mm256_mul_ps(length_sq, r), r, three));
+
+		__m256 nx = _mm256_mul_ps(vx, r), ny = _mm256_mul_ps(vy, r), nz = _mm256_mul_ps(vz, r);
+		__m256 px = _mm256_mul_ps(nx, scale), py = _mm256_mul_ps(ny, scale), pz = _mm256_mul_ps(nz, scale);
+		store_interleaved((float*)(normals + i), _mm256_castps256_ps128(nx), _mm256_castps256_ps128(ny), _mm256_castps256_ps128(nz));
+		store_interleaved((float*)(normals + i + 4), _mm256_extractf128_ps(nx, 1), _mm256_extractf128_ps(ny, 1), _mm256_extractf128_ps(nz, 1));
+		store_interleaved((float*)(positions + i), _mm256_castps256_ps128(px), _mm256_castps256_ps128(py), _mm256_castps256_ps128(pz));
+		store_interleaved((float*)(positions + i + 4), _mm256_extractf128_ps(px, 1), _mm256_extractf128_ps(py, 1), _mm256_extractf128_ps(pz, 1));
+	}
+	normalization_scalar(x + i, y + i, z + i, count - i, radius, positions + i, normals + i);
+}
+#endif
+
+/*----- Ray against sphere -----*/
+/* Diagram of quadratic, sphere at the origin
+	|o + t * d|^2 = r^2  ->  a t^2 + 2 b t + c = 0,  a = d.d, b = o.d, c = o.o - r^2
+	t = (-b -+ sqrt(b^2 - a c)) / a, a miss when the discriminant is negative
+*/
+static void ray_sphere_scalar(const float* const origin[3], const float* const direction[3], size_t count, float radius, float* t_near, float* t_far) {
+	for (size_t i = 0; i < count; i++) {
+		float ox = origin[0][i], oy = origin[1][i], oz = origin[2][i];
+		float dx = direction[0][i], dy = direction[1][i], dz = direction[2][i];
+		float a = dx * dx + dy * dy + dz * dz, b = ox * dx + oy * dy + oz * dz, c = ox * ox + oy * oy + oz * oz - radius * radius;
+		float discriminant = b * b - a * c;
+		if (discriminant < 0.0f) {
+			t_near[i] = INFINITY;
+			t_far[i] = -INFINITY;
+			continue;
+		}
+		float root = sqrtf(discriminant);
+		t_near[i] = (-b - root) / a;
+		t_far[i] = (-b + root) / a;
+	}
+}
+
+#ifdef SIMD_X86
+static void ray_sphere_sse(const float* const origin[3], const float* const direction[3], size_t count, float radius, float* t_near, float* t_far) {
+	const __m128 radius_sq = _mm_set1_ps(radius * radius), zero = _mm_setzero_ps();
+	const __m128 far_miss = _mm_set1_ps(INFINITY), near_miss = _mm_set1_ps(-INFINITY);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 ox = _mm_loadu_ps(origin[0] + i), oy = _mm_loadu_ps(origin[1] + i), oz = _mm_loadu_ps(origin[2] + i);
+		__m128 dx = _mm_loadu_ps(direction[0] + i), dy = _mm_loadu_ps(direction[1] + i), dz = _mm_loadu_ps(direction[2] + i);
+		__m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		__m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ox, dx), _mm_mul_ps(oy, dy)), _mm_mul_ps(oz, dz));
+		__m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ox, ox), _mm_mul_ps(oy, oy)), _mm_mul_ps(oz, oz)), radius_sq);
+		__m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(a, c));
+		__m128 missed = _mm_cmplt_ps(discriminant, zero);
+		__m128 root = _mm_sqrt_ps(_mm_max_ps(discriminant, zero));
+		__m128 near_t = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(zero, b), root), a);
+		__m128 far_t = _mm_div_ps(_mm_add_ps(_mm_sub_ps(zero, b), root), a);
+		//blend without SSE4.1: (mask & miss) | (~mask & t)
+		_mm_storeu_ps(t_near + i, _mm_or_ps(_mm_and_ps(missed, far_miss), _mm_andnot_ps(missed, near_t)));
+		_mm_storeu_ps(t_far + i, _mm_or_ps(_mm_and_ps(missed, near_miss), _mm_andnot_ps(missed, far_t)));
+	}
+	const float* origin_tail[3] = { origin[0] + i, origin[1] + i, origin[2] + i };
+	const float* direction_tail[3] = { direction[0] + i, direction[1] + i, direction[2] + i };
+	ray_sphere_scalar(origin_tail, direction_tail, count - i, radius, t_near + i, t_far + i);
+}
+
+SIMD_TARGET_AVX2 static void ray_sphere_avx2(const float* const origin[3], const float* const direction[3], size_t count, float radius, float* t_near, float* t_far) {
+	const __m256 radius_sq = _mm256_set1_ps(radius * radius), zero = _mm256_setzero_ps();
+	const __m256 far_miss = _mm256_set1_ps(INFINITY), near_miss = _mm256_set1_ps(-INFINITY);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 ox = _mm256_loadu_ps(origin[0] + i), oy = _mm256_loadu_ps(origin[1] + i), oz = _mm256_loadu_ps(origin[2] + i);
+		__m256 dx = _mm256_loadu_ps(direction[0] + i), dy = _mm256_loadu_ps(direction[1] + i), dz = _mm256_loadu_ps(direction[2] + i);
+		__m256 a = _mm256_fmadd_ps(dz, dz, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx)));
+		__m256 b = _mm256_fmadd_ps(oz, dz, _mm256_fmadd_ps(oy, dy, _mm256_mul_ps(ox, dx)));
+		__m256 c = _mm256_sub_ps(_mm256_fmadd_ps(oz, oz, _mm256_fmadd_ps(oy, oy, _mm256_mul_ps(ox, ox))), radius_sq);
+		__m256 discriminant = _mm256_fmsub_ps(b, b, _mm256_mul_ps(a, c));
+		__m256 missed = _mm256_cmp_ps(discriminant, zero, _CMP_LT_OQ);
+		__m256 root = _mm256_sqrt_ps(_mm256_max_ps(discriminant, zero));
+		__m256 near_t = _mm256_div_ps(_mm256_sub_ps(_mm256_sub_ps(zero, b), root), a);
+		__m256 far_t = _mm256_div_ps(_mm256_sub_ps(root, b), a);
+		_mm256_storeu_ps(t_near + i, _mm256_blendv_ps(near_t, far_miss, missed));
+		_mm256_storeu_ps(t_far + i, _mm256_blendv_ps(far_t, near_miss, missed));
+	}
+	const float* origin_tail[3] = { origin[0] + i, origin[1] + i, origin[2] + i };
+	const float* direction_tail[3] = { direction[0] + i, direction[1] + i, direction[2] + i };
+	ray_sphere_scalar(origin_tail, direction_tail, count - i, radius, t_near + i, t_far + i);
+}
+#endif
+
+/*----- Fractal noise -----*/
+/* Diagram of one noise cell
+	  011-------111		each corner hashes its integer coordinates into one of the 8 gradients (+-1, +-1, +-1),
+	  /|        /|		dots it with the offset from the corner to the point, and the 8 dots are blended
+	001-------101|		with quintic weights 6t^5 - 15t^4 + 10t^3 along x, then y, then z
+	 | 010-----|-110
+	 |/        |/
+	000-------100
+*/
+//Thomas Wang's integer hash with its multiply by 2057 spelled out as shifts
+static inline uint32_t noise_hash(uint32_t key) {
+	key = ~key + (key << 15);
+	key = key ^ (key >> 12);
+	key = key + (key << 2);
+	key = key ^ (key >> 4);
+	key = key + ((key << 3) + (key << 11));
+	key = key ^ (key >> 16);
+	return key;
+}
+static inline float noise_gradient(uint32_t hash, float x, float y, float z) {
+	return ((hash & 1 ? -x : x) + (hash & 2 ? -y : y)) + (hash & 4 ? -z : z);
+}
+static inline float noise_fade(float t) {
+	return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+static inline uint32_t octave_seed(const noise_params& params, int octave) {
+	return params.seed + uint32_t(octave) * 0x9E3779B9u;
+}
+
+static float gradient_noise_scalar(float x, float y, float z, uint32_t seed) {
+	float fx = floorf(x), fy = floorf(y), fz = floorf(z);
+	uint32_t ix = uint32_t(int32_t(fx)), iy = uint32_t(int32_t(fy)), iz = uint32_t(int32_t(fz));
+	float tx = x - fx, ty = y - fy, tz = z - fz;
+	uint32_t hz0 = noise_hash(seed + iz), hz1 = noise_hash(seed + iz + 1);
+	uint32_t h00 = noise_hash(hz0 + iy), h10 = noise_hash(hz0 + iy + 1), h01 = noise_hash(hz1 + iy), h11 = noise_hash(hz1 + iy + 1);
+
+	float n000 = noise_gradient(noise_hash(h00 + ix), tx, ty, tz), n100 = noise_gradient(noise_hash(h00 + ix + 1), tx - 1.0f, ty, tz);
+	float n010 = noise_gradient(noise_hash(h10 + ix), tx, ty - 1.0f, tz), n110 = noise_gradient(noise_hash(h10 + ix + 1), tx - 1.0f, ty - 1.0f, tz);
+	float n001 = noise_gradient(noise_hash(h01 + ix), tx, ty, tz - 1.0f), n101 = noise_gradient(noise_hash(h01 + ix + 1), tx - 1.0f, ty, tz - 1.0f);
+	float n011 = noise_gradient(noise_hash(h11 + ix), tx, ty - 1.0f, tz - 1.0f), n111 = noise_gradient(noise_hash(h11 + ix + 1), tx - 1.0f, ty - 1.0f, tz - 1.0f);
+
+	float u = noise_fade(tx), v = noise_fade(ty), w = noise_fade(tz);
+	float nx00 = n000 + u * (n100 - n000), nx10 = n010 + u * (n110 - n010);
+	float nx01 = n001 + u * (n101 - n001), nx11 = n011 + u * (n111 - n011);
+	float nxy0 = nx00 + v * (nx10 - nx00), nxy1 = nx01 + v * (nx11 - nx01);
+	return (nxy0 + w * (nxy1 - nxy0)) * NOISE_SCALE;
+}
+
+static void noise_scalar(const float* x, const float* y, const float* z, size_t count, const noise_params& params, float* out) {
+	for (size_t i = 0; i < count; i++) {
+		float sum = 0.0f, weight = 1.0f, total = 0.0f, frequency = params.frequency;
+		for (int octave = 0; octave < params.octaves; octave++) {
+			sum += weight * gradient_noise_scalar(x[i] * frequency, y[i] * frequency, z[i] * frequency, octave_seed(params, octave));
+			total += weight;
+			weight *= params.gain;
+			frequency *= params.lacunarity;
+		}
+		out[i] = total > 0.0f ? sum / total : 0.0f;
+	}
+}
+
+#ifdef SIMD_X86
+static inline __m128i noise_hash_sse(__m128i key) {
+	key = _mm_add_epi32(_mm_xor_si128(key, _mm_set1_epi32(-1)), _mm_slli_epi32(key, 15));
+	key = _mm_xor_si128(key, _mm_srli_epi32(key, 12));
+	key = _mm_add_epi32(key, _mm_slli_epi32(key, 2));
+	key = _mm_xor_si128(key, _mm_srli_epi32(key, 4));
+	key = _mm_add_epi32(key, _mm_add_epi32(_mm_slli_epi32(key, 3), _mm_slli_epi32(key, 11)));
+	key = _mm_xor_si128(key, _mm_srli_epi32(key, 16));
+	return key;
+}
+//Hash bits 0, 1 and 2 moved into the sign bit flip x, y and z
+static inline __m128 noise_gradient_sse(__m128i hash, __m128 x, __m128 y, __m128 z) {
+	const __m128i sign = _mm_set1_epi32(int(0x80000000u));
+	__m128 gx = _mm_xor_ps(x, _mm_castsi128_ps(_mm_slli_epi32(hash, 31)));
+	__m128 gy = _mm_xor_ps(y, _mm_castsi128_ps(_mm_and_si128(_mm_slli_epi32(hash, 30), sign)));
+	__m128 gz = _mm_xor_ps(z, _mm_castsi128_ps(_mm_and_si128(_mm_slli_epi32(hash, 29), sign)));
+	return _mm_add_ps(_mm_add_ps(gx, gy), gz);
+}
+static inline __m128 noise_fade_sse(__m128 t) {
+	__m128 inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f));
+	return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+}
+//Floor without SSE4.1: truncation rounds negative values up, so step those back by one
+static inline __m128i noise_floor_sse(__m128 value, __m128* fraction) {
+	__m128i truncated = _mm_cvttps_epi32(value);
+	__m128 whole = _mm_cvtepi32_ps(truncated);
+	__m128 above = _mm_cmpgt_ps(whole, value);
+	whole = _mm_sub_ps(whole, _mm_and_ps(above, _mm_set1_ps(1.0f)));
+	*fraction = _mm_sub_ps(value, whole);
+	return _mm_add_epi32(truncated, _mm_castps_si128(above));
+}
+
+static __m128 gradient_noise_sse(__m128 x, __m128 y, __m128 z, __m128i seed) {
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128 unit = _mm_set1_ps(1.0f);
+	__m128 tx, ty, tz;
+	__m128i ix = noise_floor_sse(x, &tx), iy = noise_floor_sse(y, &ty), iz = noise_floor_sse(z, &tz);
+	__m128i ix1 = _mm_add_epi32(ix, one), iy1 = _mm_add_epi32(iy, one);
+	__m128 sx = _mm_sub_ps(tx, unit), sy = _mm_sub_ps(ty, unit), sz = _mm_sub_ps(tz, unit);
+	__m128i hz0 = noise_hash_sse(_mm_add_epi32(seed, iz)), hz1 = noise_hash_sse(_mm_add_epi32(_mm_add_epi32(seed, iz), one));
+	__m128i h00 = noise_hash_sse(_mm_add_epi32(hz0, iy)), h10 = noise_hash_sse(_mm_add_epi32(hz0, iy1));
+	__m128i h01 = noise_hash_sse(_mm_add_epi32(hz1, iy)), h11 = noise_hash_sse(_mm_add_epi32(hz1, iy1));
+
+	__m128 n000 = noise_gradient_sse(noise_hash_sse(_mm_add_epi32(h00, ix)), tx, ty, tz), n100 = noise_gradient_sse(noise_hash_sse(_mm_add_epi32(h00, ix1)), sx, ty, tz);
+	__m128 n010 = noise_gradient_sse(noise_hash_sse(_mm_add_epi32(h10, ix)), tx, sy, tz), n110 = noise_gradient_sse(noise_hash_sse(_mm_add_epi32(h10, ix1)), sx, sy, tz);
+	__m128 n001 = noise_gradient_sse(noise_hash_sse(_mm_add_epi32(h01, ix)), tx, ty, sz), n101 = noise_gradient_sse(noise_hash_sse(_mm_add_epi32(h01, ix1)), sx, ty, sz);
+	__m128 n011 = noise_gradient_sse(noise_hash_sse(_mm_add_epi32(h11, ix)), tx, sy, sz), n111 = noise_gradient_sse(noise_hash_sse(_mm_add_epi32(h11, ix1)), sx, sy, sz);
+
+	__m128 u = noise_fade_sse(tx), v = noise_fade_sse(ty), w = noise_fade_sse(tz);
+	__m128 nx00 = _mm_add_ps(n000, _mm_mul_ps(u, _mm_sub_ps(n100, n000))), nx10 = _mm_add_ps(n010, _mm_mul_ps(u, _mm_sub_ps(n110, n010)));
+	__m128 nx01 = _mm_add_ps(n001, _mm_mul_ps(u, _mm_sub_ps(n101, n001))), nx11 = _mm_add_ps(n011, _mm_mul_ps(u, _mm_sub_ps(n111, n011)));
+	__m128 nxy0 = _mm_add_ps(nx00, _mm_mul_ps(v, _mm_sub_ps(nx10, nx00))), nxy1 = _mm_add_ps(nx01, _mm_mul_ps(v, _mm_sub_ps(nx11, nx01)));
+	return _mm_mul_ps(_mm_add_ps(nxy0, _mm_mul_ps(w, _mm_sub_ps(nxy1, nxy0))), _mm_set1_ps(NOISE_SCALE));
+}
+
+static void noise_sse(const float* x, const float* y, const float* z, size_t count, const noise_params& params, float* out) {
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+		__m128 sum = _mm_setzero_ps();
+		float weight = 1.0f, total = 0.0f, frequency = params.frequency;
+		for (int octave = 0; octave < params.octaves; octave++) {
+			__m128 scale = _mm_set1_ps(frequency);
+			__m128 noise = gradient_noise_sse(_mm_mul_ps(vx, scale), _mm_mul_ps(vy, scale), _mm_mul_ps(vz, scale), _mm_set1_epi32(int(octave_seed(params, octave))));
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weight), noise));
+			total += weight;
+			weight *= params.gain;
+			frequency *= params.lacunarity;
+		}
+		_mm_storeu_ps(out + i, total > 0.0f ? _mm_div_ps(sum, _mm_set1_ps(total)) : _mm_setzero_ps());
+	}
+	noise_scalar(x + i, y + i, z + i, count - i, params, out + i);
+}
+
+SIMD_TARGET_AVX2 static inline __m256i noise_hash_avx2(__m256i key) {
+	key = _mm256_add_epi32(_mm256_xor_si256(key, _mm256_set1_epi32(-1)), _mm256_slli_epi32(key, 15));
+	key = _mm256_xor_si256(key, _mm256_srli_epi32(key, 12));
+	key = _mm256_add_epi32(key, _mm256_slli_epi32(key, 2));
+	key = _mm256_xor_si256(key, _mm256_srli_epi32(key, 4));
+	key = _mm256_add_epi32(key, _mm256_add_epi32(_mm256_slli_epi32(key, 3), _mm256_slli_epi32(key, 11)));
+	key = _mm256_xor_si256(key, _mm256_srli_epi32(key, 16));
+	return key;
+}
+SIMD_TARGET_AVX2 static inline __m256 noise_gradient_avx2(__m256i hash, __m256 x, __m256 y, __m256 z) {
+	const __m256i sign = _mm256_set1_epi32(int(0x80000000u));
+	__m256 gx = _mm256_xor_ps(x, _mm256_castsi256_ps(_mm256_slli_epi32(hash, 31)));
+	__m256 gy = _mm256_xor_ps(y, _mm256_castsi256_ps(_mm256_and_si256(_mm256_slli_epi32(hash, 30), sign)));
+	__m256 gz = _mm256_xor_ps(z, _mm256_castsi256_ps(_mm256_and_si256(_mm256_slli_epi32(hash, 29), sign)));
+	return _mm256_add_ps(_mm256_add_ps(gx, gy), gz);
+}
+SIMD_TARGET_AVX2 static inline __m256 noise_fade_avx2(__m256 t) {
+	__m256 inner = _mm256_fmadd_ps(t, _mm256_fmsub_ps(t, _mm256_set1_ps(6.0f), _mm256_set1_ps(15.0f)), _mm256_set1_ps(10.0f));
+	return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), inner);
+}
+
+SIMD_TARGET_AVX2 static __m256 gradient_noise_avx2(__m256 x, __m256 y, __m256 z, __m256i seed) {
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256 unit = _mm256_set1_ps(1.0f);
+	__m256 fx = _mm256_floor_ps(x), fy = _mm256_floor_ps(y), fz = _mm256_floor_ps(z);
+	__m256i ix = _mm256_cvttps_epi32(fx), iy = _mm256_cvttps_epi32(fy), iz = _mm256_cvttps_epi32(fz);
+	__m256i ix1 = _mm256_add_epi32(ix, one), iy1 = _mm256_add_epi32(iy, one);
+	__m256 tx = _mm256_sub_ps(x, fx), ty = _mm256_sub_ps(y, fy), tz = _mm256_sub_ps(z, fz);
+	__m256 sx = _mm256_sub_ps(tx, unit), sy = _mm256_sub_ps(ty, unit), sz = _mm256_sub_ps(tz, unit);
+	__m256i hz0 = noise_hash_avx2(_mm256_add_epi32(seed, iz)), hz1 = noise_hash_avx2(_mm256_add_epi32(_mm256_add_epi32(seed, iz), one));
+	__m256i h00 = noise_hash_avx2(_mm256_add_epi32(hz0, iy)), h10 = noise_hash_avx2(_mm256_add_epi32(hz0, iy1));
+	__m256i h01 = noise_hash_avx2(_mm256_add_epi32(hz1, iy)), h11 = noise_hash_avx2(_mm256_add_epi32(hz1, iy1));
+
+	__m256 n000 = noise_gradient_avx2(noise_hash_avx2(_mm256_add_epi32(h00, ix)), tx, ty, tz), n100 = noise_gradient_avx2(noise_hash_avx2(_mm256_add_epi32(h00, ix1)), sx, ty, tz);
+	__m256 n010 = noise_gradient_avx2(noise_hash_avx2(_mm256_add_epi32(h10, ix)), tx, sy, tz), n110 = noise_gradient_avx2(noise_hash_avx2(_mm256_add_epi32(h10, ix1)), sx, sy, tz);
+	__m256 n001 = noise_gradient_avx2(noise_hash_avx2(_mm256_add_epi32(h01, ix)), tx, ty, sz), n101 = noise_gradient_avx2(noise_hash_avx2(_mm256_add_epi32(h01, ix1)), sx, ty, sz);
+	__m256 n011 = noise_gradient_avx2(noise_hash_avx2(_mm256_add_epi32(h11, ix)), tx, sy, sz), n111 = noise_gradient_avx2(noise_hash_avx2(_mm256_add_epi32(h11, ix1)), sx, sy, sz);
+
+	__m256 u = noise_fade_avx2(tx), v = noise_fade_avx2(ty), w = noise_fade_avx2(tz);
+	__m256 nx00 = _mm256_fmadd_ps(u, _mm256_sub_ps(n100, n000), n000), nx10 = _mm256_fmadd_ps(u, _mm256_sub_ps(n110, n010), n010);
+	__m256 nx01 = _mm256_fmadd_ps(u, _mm256_sub_ps(n101, n001), n001), nx11 = _mm256_fmadd_ps(u, _mm256_sub_ps(n111, n011), n011);
+	__m256 nxy0 = _mm256_fmadd_ps(v, _mm256_sub_ps(nx10, nx00), nx00), nxy1 = _mm256_fmadd_ps(v, _mm256_sub_ps(nx11, nx01), nx01);
+	return _mm256_mul_ps(_mm256_fmadd_ps(w, _mm256_sub_ps(nxy1, nxy0), nxy0), _mm256_set1_ps(NOISE_SCALE));
+}
+
+SIMD_TARGET_AVX2 static void noise_avx2(const float* x, const float* y, const float* z, size_t count, const noise_params& params, float* out) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+		__m256 sum = _mm256_setzero_ps();
+		float weight = 1.0f, total = 0.0f, frequency = params.frequency;
+		for (int octave = 0; octave < params.octaves; octave++) {
+			__m256 scale = _mm256_set1_ps(frequency);
+			__m256 noise = gradient_noise_avx2(_mm256_mul_ps(vx, scale), _mm256_mul_ps(vy, scale), _mm256_mul_ps(vz, scale), _mm256_set1_epi32(int(octave_seed(params, octave))));
+			sum = _mm256_fmadd_ps(_mm256_set1_ps(weight), noise, sum);
+			total += weight;
+			weight *= params.gain;
+			frequency *= params.lacunarity;
+		}
+		_mm256_storeu_ps(out + i, total > 0.0f ? _mm256_div_ps(sum, _mm256_set1_ps(total)) : _mm256_setzero_ps());
+	}
+	noise_scalar(x + i, y + i, z + i, count - i, params, out + i);
+}
+#endif
+
+static noise_kernel select_noise_kernel(simd_level level) {
+#ifdef SIMD_X86
+	if (level == SIMD_AVX2)
+		return noise_avx2;
+	if (level == SIMD_SSE)
+		return noise_sse;
+#endif
+	return noise_scalar;
+}
+
+static ray_sphere_kernel select_ray_kernel(simd_level level) {
+#ifdef SIMD_X86
+	if (level == SIMD_AVX2)
+		return ray_sphere_avx2;
+	if (level == SIMD_SSE)
+		return ray_sphere_sse;
+#endif
+	return ray_sphere_scalar;
+}
+
+static normalization_kernel select_kernel(simd_level level) {
+#ifdef SIMD_X86
+	if (level == SIMD_AVX2)
+		return normalization_avx2;
+	if (level == SIMD_SSE)
+		return normalization_sse;
+#endif
+	return normalization_scalar;
+}
+
+void sphere_normalization(const float* x, const float* y, const float* z, size_t count, float radius, glm::vec3* positions, glm::vec3* normals) {
+	static normalization_kernel kernel = select_kernel(detect_simd_level());
+	kernel(x, y, z, count, radius, positions, normals);
+}
+void sphere_normalization(simd_level level, const float* x, const float* y, const float* z, size_t count, float radius, glm::vec3* positions, glm::vec3* normals) {
+	if (level > detect_simd_level())
+		level = detect_simd_level();
+	select_kernel(level)(x, y, z, count, radius, positions, normals);
+}
+void ray_sphere_intersection(const float* const origin[3], const float* const direction[3], size_t count, float radius, float* t_near, float* t_far) {
+	static ray_sphere_kernel kernel = select_ray_kernel(detect_simd_level());
+	kernel(origin, direction, count, radius, t_near, t_far);
+}
+void ray_sphere_intersection(simd_level level, const float* const origin[3], const float* const direction[3], size_t count, float radius, float* t_near, float* t_far) {
+	if (level > detect_simd_level())
+		level = detect_simd_level();
+	select_ray_kernel(level)(origin, direction, count, radius, t_near, t_far);
+}
+void fractal_noise(const float* x, const float* y, const float* z, size_t count, const noise_params& params, float* out) {
+	static noise_kernel kernel = select_noise_kernel(detect_simd_level());
+	kernel(x, y, z, count, params, out);
+}
+void fractal_noise(simd_level level, const float* x, const float* y, const float* z, size_t count, const noise_params& params, float* out) {
+	if (level > detect_simd_level())
+		level = detect_simd_level();
+	select_noise_kernel(level)(x, y, z, count, params, out);
+}
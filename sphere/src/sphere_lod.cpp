@@ -0,0 +1,179 @@
+#include <math.h>
+#include <thread>
+#include "../header/sphere_lod.h"
+#include "../header/sphere_optimize.h"
+#include "../header/profiler.h"
+
+#define LOD_HYSTERESIS 0.15f //extra fraction of a level the view must move before switching without blending
+
+sphere_lod::sphere_lod(int min_level, int max_level, double radius, thread_pool* pool, mesh_loader loader)
+	: target_edge_pixels(8.0f), blend(true), min_level(min_level), max_level(max_level), radius(radius),
+	current_level(min_level), pool(pool), loader(loader), levels(new lod_level[max_level - min_level + 1]) {
+	pending_loads = 0;
+	for (int level = min_level; level <= max_level; level++) {
+		levels[level - min_level].state = LEVEL_EMPTY;
+		levels[level - min_level].from_cache = false;
+	}
+	request(min_level); //coarsest level is always available to fall back on
+}
+sphere_lod::~sphere_lod() {
+	while (pending_loads.load() > 0)
+		std::this_thread::yield();
+}
+
+void sphere_lod::request(int level) {
+	int expected = LEVEL_EMPTY;
+	if (level < min_level || level > max_level)
+		return;
+	if (!levels[level - min_level].state.compare_exchange_strong(expected, LEVEL_LOADING))
+		return;
+
+	pending_loads++;
+	if (pool)
+		pool->submit([this, level] { load(level); });
+	else
+		load(level);
+}
+
+void sphere_lod::load(int level) {
+	PROFILE_ZONE("lod_load");
+	lod_level& entry = levels[level - min_level];
+	char cache_path[256];
+
+	mesh_cache_path(cache_path, sizeof(cache_path), level, radius);
+	entry.from_cache = entry.cache.open(cache_path, level, radius, VERTEX_LAYOUT_COMPACT_M);
+	if (!entry.from_cache) {
+		if (loader)
+			loader(&entry.mesh, level);
+		else
+			generate_sphere_mesh(&entry.mesh, level, radius, pool);
+		generate_morph_targets(&entry.mesh, pool);
+		build_sphere_patches(&entry.mesh);
+		optimize_sphere_mesh(&entry.mesh, pool);
+
+		//the freshly written file already holds the encoded vertices, so the GL thread uploads it as is
+		if (write_mesh_cache(cache_path, entry.mesh, VERTEX_LAYOUT_COMPACT_M, pool))
+			entry.from_cache = entry.cache.open(cache_path, level, radius, VERTEX_LAYOUT_COMPACT_M, false);
+		if (entry.from_cache)
+			entry.mesh = sphere_mesh();
+	}
+
+	entry.state = LEVEL_LOADED;
+	pending_loads--;
+}
+
+void sphere_lod::update(GLuint program_ID) {
+	PROFILE_ZONE("lod_update");
+	for (int level = min_level; level <= max_level; level++) {
+		lod_level& entry = levels[level - min_level];
+		if (entry.state.load() != LEVEL_LOADED)
+			continue;
+
+		//CPU copies are dropped once the driver owns the data
+		if (entry.from_cache) {
+			entry.buffer.upload(entry.cache, program_ID);
+			entry.cache.close();
+		}
+		else {
+			entry.buffer.upload(entry.mesh, program_ID);
+			entry.mesh = sphere_mesh();
+		}
+		entry.state = LEVEL_RESIDENT;
+		return; //one upload per frame keeps large levels from stacking into a single hitch
+	}
+}
+
+bool sphere_lod::resident(int level) const {
+	if (level < min_level || level > max_level)
+		return false;
+	return levels[level - min_level].state.load() == LEVEL_RESIDENT;
+}
+
+//Closest resident level, preferring coarser ones since they are cheaper to draw while waiting
+int sphere_lod::nearest_resident(int level) const {
+	for (int coarser = level; coarser >= min_level; coarser--) {
+		if (resident(coarser))
+			return coarser;
+	}
+	for (int finer = level + 1; finer <= max_level; finer++) {
+		if (resident(finer))
+			return finer;
+	}
+	return -1;
+}
+
+/* Diagram of level choice
+	projected radius r_px = (viewport_height / 2) * radius / (sqrt(d^2 - radius^2) * tan(fov_y / 2))
+	an octant edge spans a quarter great circle, split into 2^level triangle edges:
+		edge_px(level) = (pi / 2) * r_px / 2^level
+	solving edge_px = target_edge_pixels gives the continuous level below
+*/
+lod_selection sphere_lod::select(const glm::vec3& center, const glm::vec3& eye, float fov_y, float viewport_height) {
+	lod_selection selection;
+	float distance = glm::length(eye - center), level_f;
+
+	if (distance <= radius)
+		level_f = float(max_level);
+	else {
+		float tangent_distance = sqrtf(distance * distance - float(radius * radius));
+		float projected_radius = 0.5f * viewport_height * float(radius) / (tangent_distance * tanf(0.5f * fov_y));
+		level_f = log2f(1.5707963f * projected_radius / target_edge_pixels);
+	}
+	if (level_f < float(min_level))
+		level_f = float(min_level);
+	if (level_f > float(max_level))
+		level_f = float(max_level);
+
+	if (blend) {
+		selection.level = int(ceilf(level_f));
+		selection.morph = float(selection.level) - level_f;
+	}
+	else {
+		selection.level = current_level;
+		if (fabsf(level_f - float(current_level)) > 0.5f + LOD_HYSTERESIS)
+			selection.level = int(floorf(level_f + 0.5f));
+		selection.morph = 0.0f;
+	}
+	if (selection.level == min_level)
+		selection.morph = 0.0f;
+	current_level = selection.level;
+
+	//load the wanted level and the coarser one the view falls back to next, drawing what is already there meanwhile
+	request(selection.level);
+	request(selection.level - 1);
+	if (!resident(selection.level)) {
+		selection.level = nearest_resident(selection.level);
+		selection.morph = 0.0f;
+	}
+	return selection;
+}
+
+void sphere_lod::draw(const lod_selection& selection) {
+	if (selection.level < 0)
+		return;
+	levels[selection.level - min_level].buffer.draw();
+}
+
+size_t sphere_lod::draw(const lod_selection& selection, const view_frustum& frustum, const glm::vec3& eye) {
+	if (selection.level < 0)
+		return 0;
+	return levels[selection.level - min_level].buffer.draw_visible(frustum, eye);
+}
+
+size_t sphere_lod::triangle_count(const lod_selection& selection) const {
+	return selection.level < 0 ? 0 : sphere_triangle_count(selection.level);
+}
+
+GLuint sphere_lod::vertex_array(const lod_selection& selection) const {
+	return selection.level < 0 ? 0 : levels[selection.level - min_level].buffer.VAO;
+}
+
+void sphere_lod::release() {
+	while (pending_loads.load() > 0)
+		std::this_thread::yield();
+	for (int level = min_level; level <= max_level; level++) {
+		levels[level - min_level].buffer.release();
+		levels[level - min_level].cache.close();
+		levels[level - min_level].state = LEVEL_EMPTY;
+	}
+}
@@ -0,0 +1,272 @@
+#include "../header/sphere_mesh.h"
+#include "../header/sphere_kernels.h"
+#include "../header/mesh_cache.h"
+#include "../header/profiler.h"
+#include "../header/gl_state.h"
+
+int sphere_divisions(int level) {
+	return 1 << level;
+}
+size_t sphere_vertex_count(int level) {
+	size_t n = sphere_divisions(level);
+	return 4 * n * n + 2;
+}
+size_t sphere_triangle_count(int level) {
+	size_t n = sphere_divisions(level);
+	return 8 * n * n;
+}
+GLenum sphere_index_type(size_t vertex_count) {
+	if (vertex_count <= 0xFFFF + 1)
+		return GL_UNSIGNED_SHORT;
+	return GL_UNSIGNED_INT;
+}
+
+glm::vec4 sphere_vertex_color(size_t index) {
+	switch (index % 3) {
+	case 0: return glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+	case 1: return glm::vec4(0.0f, 1.0f, 0.0f, 1.0f);
+	default: return glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	}
+}
+
+//Writes every vertex of the ring at height y directly into its slot of the output spans; lattice points are
+//gathered in blocks as separate x, y, z arrays so the projection runs as one vectorized pass per block
+static void write_ring(sphere_mesh* mesh, int y, int n) {
+	const size_t block_size = 256;
+	float lattice_x[block_size], lattice_y[block_size], lattice_z[block_size];
+	size_t ring_size = sphere_ring_size(y, n);
+	size_t offset = sphere_ring_offset(y, n);
+	glm::vec3* positions = mesh->positions.data() + offset;
+	glm::vec3* normals = mesh->normals.data() + offset;
+	glm::vec4* colors = mesh->colors.data() + offset;
+
+	for (size_t block = 0; block < ring_size; block += block_size) {
+		size_t count = ring_size - block < block_size ? ring_size - block : block_size;
+		for (size_t i = 0; i < count; i++) {
+			int x = 0, z = 0;
+			sphere_ring_point(y, n, block + i, &x, &z);
+			lattice_x[i] = float(x);
+			lattice_y[i] = float(y);
+			lattice_z[i] = float(z);
+		}
+		sphere_normalization(lattice_x, lattice_y, lattice_z, count, float(mesh->radius), positions + block, normals + block);
+	}
+
+	for (size_t p = 0; p < ring_size; p++)
+		colors[p] = sphere_vertex_color(offset + p);
+}
+
+static void write_face_row(sphere_mesh* mesh, int face, int row, int n) {
+	sphere_face_row(face, row, n, mesh->indices.data() + 3 * sphere_row_offset(face, row, n));
+}
+
+//Every vertex and triangle has a closed-form slot, so output is sized once and filled without further allocation;
+//slots never overlap, which lets rings and face rows be written by any thread in any order with identical output
+void generate_sphere_mesh(sphere_mesh* mesh, int level, double radius, thread_pool* pool) {
+	PROFILE_ZONE("generate_mesh");
+	int n = sphere_divisions(level);
+
+	mesh->level = level;
+	mesh->radius = radius;
+	mesh->positions.resize(sphere_vertex_count(level));
+	mesh->normals.resize(sphere_vertex_count(level));
+	mesh->colors.resize(sphere_vertex_count(level));
+	mesh->indices.resize(sphere_triangle_count(level) * 3);
+
+	if (pool == NULL || pool->size() == 1) {
+		for (int y = n; y >= -n; y--)
+			write_ring(mesh, y, n);
+		for (int face = 0; face < 8; face++) {
+			for (int row = 0; row < n; row++)
+				write_face_row(mesh, face, row, n);
+		}
+		return;
+	}
+
+	//rows differ in length, so hand them out in small chunks and let idle threads pick up the rest
+	size_t ring_count = 2 * size_t(n) + 1, row_count = 8 * size_t(n);
+	size_t grain = row_count / (size_t(pool->size()) * 8);
+	pool->parallel_for(ring_count, grain / 2, [mesh, n](size_t begin, size_t end) {
+		for (size_t ring = begin; ring < end; ring++)
+			write_ring(mesh, n - int(ring), n);
+	});
+	pool->parallel_for(row_count, grain, [mesh, n](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+			write_face_row(mesh, int(i / n), int(i % n), n);
+	});
+}
+
+//Coarse position of one lattice point of an even level; it either exists on the level above or is an edge midpoint
+static glm::vec3 morph_target(int x, int y, int z, float radius) {
+	int a[3] = {}, b[3] = {};
+	if (!sphere_morph_parents(x, y, z, a, b))
+		return glm::normalize(glm::vec3(float(x), float(y), float(z))) * radius;
+
+	glm::vec3 end_a = glm::normalize(glm::vec3(float(a[0]), float(a[1]), float(a[2]))) * radius;
+	glm::vec3 end_b = glm::normalize(glm::vec3(float(b[0]), float(b[1]), float(b[2]))) * radius;
+	return (end_a + end_b) * 0.5f;
+}
+
+static void write_morph_ring(sphere_mesh* mesh, int y, int n) {
+	size_t offset = sphere_ring_offset(y, n);
+	for (size_t p = 0; p < sphere_ring_size(y, n); p++) {
+		int x = 0, z = 0;
+		sphere_ring_point(y, n, p, &x, &z);
+		mesh->morph_targets[offset + p] = n == 1 ? mesh->positions[offset + p] : morph_target(x, y, z, float(mesh->radius));
+	}
+}
+
+void generate_morph_targets(sphere_mesh* mesh, thread_pool* pool) {
+	PROFILE_ZONE("morph_targets");
+	int n = sphere_divisions(mesh->level);
+	mesh->morph_targets.resize(mesh->positions.size());
+	if (pool == NULL) {
+		for (int y = n; y >= -n; y--)
+			write_morph_ring(mesh, y, n);
+		return;
+	}
+	pool->parallel_for(2 * size_t(n) + 1, 1, [mesh, n](size_t begin, size_t end) {
+		for (size_t ring = begin; ring < end; ring++)
+			write_morph_ring(mesh, n - int(ring), n);
+	});
+}
+
+/*----- Mesh buffer -----*/
+mesh_buffer::mesh_buffer() : VAO(0), VBO(0), EBO(0), index_count(0), index_type(GL_UNSIGNED_INT), layout(VERTEX_LAYOUT_COMPACT), resident_layout(VERTEX_LAYOUT_COMPACT) {}
+
+void mesh_buffer::setup_attributes(const vertex_layout& vertex_format, size_t vertex_count, GLuint program_ID) {
+	GLint instance_position, instance_color;
+
+	vertex_format.setup(program_ID, vertex_count);
+
+	//without an instance buffer the instance attributes read these constants: unit radius at the origin, no tint
+	instance_position = glGetAttribLocation(program_ID, "iPositionRadius");
+	instance_color = glGetAttribLocation(program_ID, "iColor");
+	if (instance_position >= 0)
+		glVertexAttrib4f(instance_position, 0.0f, 0.0f, 0.0f, 1.0f);
+	if (instance_color >= 0)
+		glVertexAttrib4f(instance_color, 0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+void mesh_buffer::upload(const sphere_mesh& mesh, GLuint program_ID) {
+	PROFILE_ZONE("mesh_upload");
+	size_t vertex_count = mesh.positions.size();
+	vertex_layout vertex_format = make_vertex_layout(vertex_layout_with_morph(layout, mesh.morph_targets.size() == vertex_count));
+	std::vector<unsigned char> vertex_bytes(vertex_format.buffer_size(vertex_count));
+
+	vertex_format.encode(mesh, vertex_bytes.data());
+	if (!VAO) {
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glGenBuffers(1, &EBO);
+	}
+	gl_state.bind_vertex_array(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(vertex_bytes.size()), vertex_bytes.data(), GL_STATIC_DRAW);
+	setup_attributes(vertex_format, vertex_count, program_ID);
+	resident_layout = vertex_format.id;
+	patches = mesh.patches;
+
+	//element buffer binding is recorded in the VAO
+	index_count = GLsizei(mesh.indices.size());
+	index_type = sphere_index_type(vertex_count);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	if (index_type == GL_UNSIGNED_SHORT) {
+		std::vector<GLushort> packed(mesh.indices.begin(), mesh.indices.end());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, packed.size() * sizeof(GLushort), packed.data(), GL_STATIC_DRAW);
+	}
+	else
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(GLuint), mesh.indices.data(), GL_STATIC_DRAW);
+
+	gl_state.bind_vertex_array(0);
+}
+void mesh_buffer::upload(const mesh_cache& cache, GLuint program_ID) {
+	PROFILE_ZONE("cache_upload");
+	if (!VAO) {
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glGenBuffers(1, &EBO);
+	}
+	gl_state.bind_vertex_array(VAO);
+
+	//cache bytes are already in VBO/EBO layout, so the mapping is handed to the driver as is
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(cache.header->vertex_bytes), cache.vertex_data(), GL_STATIC_DRAW);
+	setup_attributes(make_vertex_layout(vertex_layout_id(cache.header->vertex_layout)), size_t(cache.header->vertex_count), program_ID);
+	resident_layout = vertex_layout_id(cache.header->vertex_layout);
+
+	index_count = GLsizei(cache.header->index_count);
+	index_type = GLenum(cache.header->index_type);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(cache.header->index_bytes), cache.index_data(), GL_STATIC_DRAW);
+	patches.assign(cache.patch_data(), cache.patch_data() + cache.header->patch_count);
+
+	gl_state.bind_vertex_array(0);
+}
+
+void mesh_buffer::update_vertices(const sphere_mesh& mesh, size_t first, size_t count) {
+	vertex_layout vertex_format = make_vertex_layout(resident_layout);
+	std::vector<unsigned char> vertex_bytes(vertex_format.buffer_size(count));
+
+	if (count == 0)
+		return;
+	vertex_format.encode(mesh, first, first + count, vertex_bytes.data());
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	if (vertex_format.interleaved)
+		glBufferSubData(GL_ARRAY_BUFFER, GLintptr(first * vertex_format.vertex_size), GLsizeiptr(vertex_bytes.size()), vertex_bytes.data());
+	else {
+		//each planar attribute is its own run, attribute.offset * vertex_count into the buffer
+		size_t vertex_count = mesh.positions.size();
+		for (size_t a = 0; a < vertex_format.attributes.size(); a++) {
+			size_t offset = vertex_format.attributes[a].offset;
+			size_t size = (a + 1 < vertex_format.attributes.size() ? vertex_format.attributes[a + 1].offset : vertex_format.vertex_size) - offset;
+			glBufferSubData(GL_ARRAY_BUFFER, GLintptr(offset * vertex_count + first * size), GLsizeiptr(count * size), vertex_bytes.data() + offset * count);
+		}
+	}
+	patches = mesh.patches;
+}
+void mesh_buffer::draw(GLenum primitive) {
+	gl_state.bind_vertex_array(VAO);
+	glDrawElements(primitive, index_count, index_type, (void*)0);
+}
+//Adjacent visible patches are merged, so a fully visible mesh is still a single range
+size_t mesh_buffer::draw_visible(const view_frustum& frustum, const glm::vec3& eye) {
+	size_t index_size = index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	size_t drawn = 0;
+	uint32_t run_end = UINT32_MAX;
+
+	if (patches.empty()) {
+		draw();
+		return size_t(index_count) / 3;
+	}
+	visible_counts.clear();
+	visible_offsets.clear();
+	for (size_t i = 0; i < patches.size(); i++) {
+		if (!patch_visible(patches[i], frustum, eye))
+			continue;
+		if (patches[i].first_index == run_end)
+			visible_counts.back() += GLsizei(patches[i].index_count);
+		else {
+			visible_counts.push_back(GLsizei(patches[i].index_count));
+			visible_offsets.push_back((const void*)(patches[i].first_index * index_size));
+		}
+		run_end = patches[i].first_index + patches[i].index_count;
+		drawn += patches[i].index_count / 3;
+	}
+	if (visible_counts.empty())
+		return 0;
+	gl_state.bind_vertex_array(VAO);
+	glMultiDrawElements(GL_TRIANGLES, visible_counts.data(), index_type, visible_offsets.data(), GLsizei(visible_counts.size()));
+	return drawn;
+}
+void mesh_buffer::release() {
+	if (!VAO)
+		return;
+	glDeleteBuffers(1, &EBO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteVertexArrays(1, &VAO);
+	gl_state.vertex_array_deleted(VAO);
+	VAO = VBO = EBO = 0;
+	index_count = 0;
+	patches.clear();
+}
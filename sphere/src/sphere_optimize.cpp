@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <vector>
+#include "../header/sphere_optimize.h"
+#include "../header/sphere_mesh.h"
+#include "../header/profiler.h"
+
+#define NO_VERTEX uint32_t(-1)
+
+/*----- Tipsify -----*/
+//Next fanning vertex: a cached candidate with triangles left, preferring the one whose remaining fan
+//fits in the cache and has sat there longest; otherwise a dead end is skipped
+static uint32_t next_vertex(const std::vector<uint32_t>& candidates, const std::vector<uint32_t>& live, const std::vector<int>& stamps, int stamp, int cache_size,
+	std::vector<uint32_t>* dead_ends, uint32_t* cursor) {
+	uint32_t best = NO_VERTEX;
+	int best_priority = -1;
+
+	for (uint32_t v : candidates) {
+		if (live[v] == 0)
+			continue;
+		int priority = 0;
+		if (stamp - stamps[v] + 2 * int(live[v]) <= cache_size)
+			priority = stamp - stamps[v];
+		if (priority > best_priority) {
+			best_priority = priority;
+			best = v;
+		}
+	}
+	if (best != NO_VERTEX)
+		return best;
+
+	while (!dead_ends->empty()) {
+		uint32_t v = dead_ends->back();
+		dead_ends->pop_back();
+		if (live[v] > 0)
+			return v;
+	}
+	for (; *cursor < live.size(); (*cursor)++) {
+		if (live[*cursor] > 0)
+			return *cursor;
+	}
+	return NO_VERTEX;
+}
+
+void optimize_vertex_cache(GLuint* indices, size_t index_count, int cache_size) {
+	size_t triangle_count = index_count / 3;
+	std::vector<uint32_t> local(index_count), slots, offsets, triangles, live, candidates, dead_ends;
+	std::vector<GLuint> output;
+	std::vector<int> stamps;
+	std::vector<bool> emitted(triangle_count, false);
+	uint32_t fan = 0, cursor = 0;
+	int stamp = cache_size + 1;
+
+	uint32_t vertex_count = 0;
+
+	if (triangle_count < 2)
+		return;
+
+	//ranges reference a slice of the mesh, so work on compact local vertex numbers given in order of first use
+	GLuint low = *std::min_element(indices, indices + index_count), high = *std::max_element(indices, indices + index_count);
+	slots.assign(size_t(high - low) + 1, NO_VERTEX);
+	for (size_t i = 0; i < index_count; i++) {
+		uint32_t& slot = slots[indices[i] - low];
+		if (slot == NO_VERTEX)
+			slot = vertex_count++;
+		local[i] = slot;
+	}
+
+	//triangles around each vertex, CSR like sphere_adjacency
+	offsets.assign(vertex_count + 1, 0);
+	for (size_t i = 0; i < index_count; i++)
+		offsets[local[i] + 1]++;
+	for (size_t v = 0; v < vertex_count; v++)
+		offsets[v + 1] += offsets[v];
+	live.resize(vertex_count);
+	for (size_t v = 0; v < vertex_count; v++)
+		live[v] = offsets[v + 1] - offsets[v];
+	triangles.resize(index_count);
+	{
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < index_count; i++)
+			triangles[fill[local[i]]++] = uint32_t(i / 3);
+	}
+
+	stamps.assign(vertex_count, 0);
+	output.reserve(index_count);
+	while (fan != NO_VERTEX) {
+		candidates.clear();
+		for (uint32_t k = offsets[fan]; k < offsets[fan + 1]; k++) {
+			uint32_t t = triangles[k];
+			if (emitted[t])
+				continue;
+			for (int corner = 0; corner < 3; corner++) {
+				uint32_t v = local[3 * t + corner];
+				output.push_back(indices[3 * t + corner]);
+				dead_ends.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (stamp - stamps[v] > cache_size)
+					stamps[v] = stamp++;
+			}
+			emitted[t] = true;
+		}
+		fan = next_vertex(candidates, live, stamps, stamp, cache_size, &dead_ends, &cursor);
+	}
+	std::copy(output.begin(), output.end(), indices);
+}
+
+//Small patches on low levels are sometimes already better off in generation order
+static void optimize_range(GLuint* indices, size_t index_count) {
+	std::vector<GLuint> original(indices, indices + index_count);
+	size_t before = measure_vertex_cache(indices, index_count).transforms;
+
+	optimize_vertex_cache(indices, index_count);
+	if (measure_vertex_cache(indices, index_count).transforms > before)
+		std::copy(original.begin(), original.end(), indices);
+}
+
+/*----- Vertex fetch order -----*/
+template<typename T>
+static void permute(std::vector<T>* values, const std::vector<uint32_t>& remap) {
+	std::vector<T> reordered(values->size());
+	for (size_t v = 0; v < values->size(); v++)
+		reordered[remap[v]] = (*values)[v];
+	values->swap(reordered);
+}
+
+void optimize_sphere_mesh(sphere_mesh* mesh, thread_pool* pool) {
+	PROFILE_ZONE("optimize_mesh");
+	size_t vertex_count = mesh->positions.size();
+	uint32_t next = 0;
+
+	if (mesh->patches.empty())
+		optimize_range(mesh->indices.data(), mesh->indices.size());
+	else {
+		std::vector<GLuint> original(mesh->indices);
+		size_t before = measure_vertex_cache(mesh->indices.data(), mesh->indices.size()).transforms;
+		auto optimize_patches = [mesh](size_t begin, size_t end) {
+			for (size_t p = begin; p < end; p++)
+				optimize_range(mesh->indices.data() + mesh->patches[p].first_index, mesh->patches[p].index_count);
+		};
+		if (pool)
+			pool->parallel_for(mesh->patches.size(), 1, optimize_patches);
+		else
+			optimize_patches(0, mesh->patches.size());
+		//patches are judged each from a cold cache, but the stream runs through them with the cache carried over
+		if (measure_vertex_cache(mesh->indices.data(), mesh->indices.size()).transforms > before)
+			mesh->indices.swap(original);
+	}
+
+	//vertices are numbered in the order the optimized stream first touches them
+	mesh->vertex_remap.assign(vertex_count, NO_VERTEX);
+	for (size_t i = 0; i < mesh->indices.size(); i++) {
+		GLuint v = mesh->indices[i];
+		if (mesh->vertex_remap[v] == NO_VERTEX)
+			mesh->vertex_remap[v] = next++;
+		mesh->indices[i] = mesh->vertex_remap[v];
+	}
+	for (size_t v = 0; v < vertex_count; v++) {
+		if (mesh->vertex_remap[v] == NO_VERTEX)
+			mesh->vertex_remap[v] = next++;
+	}
+
+	permute(&mesh->positions, mesh->vertex_remap);
+	permute(&mesh->normals, mesh->vertex_remap);
+	permute(&mesh->colors, mesh->vertex_remap);
+	if (mesh->morph_targets.size() == vertex_count)
+		permute(&mesh->morph_targets, mesh->vertex_remap);
+}
+
+//A FIFO holds a vertex until cache_size more misses have happened, so one miss count per vertex is the whole cache
+vertex_cache_stats measure_vertex_cache(const GLuint* indices, size_t index_count, int cache_size) {
+	vertex_cache_stats stats;
+	std::vector<size_t> entered;
+	GLuint low = 0;
+
+	stats.triangles = index_count / 3;
+	stats.transforms = 0;
+	stats.vertices = 0;
+	if (index_count) {
+		low = *std::min_element(indices, indices + index_count);
+		entered.assign(size_t(*std::max_element(indices, indices + index_count) - low) + 1, size_t(-1));
+	}
+	for (size_t i = 0; i < index_count; i++) {
+		size_t& miss = entered[indices[i] - low];
+		if (miss != size_t(-1) && stats.transforms - miss <= size_t(cache_size))
+			continue;
+		stats.vertices += miss == size_t(-1);
+		miss = stats.transforms++;
+	}
+	stats.acmr = stats.triangles ? double(stats.transforms) / stats.triangles : 0.0;
+	stats.atvr = stats.vertices ? double(stats.transforms) / stats.vertices : 0.0;
+	return stats;
+}
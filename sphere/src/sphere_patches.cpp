@@ -0,0 +1,139 @@
+#include <math.h>
+#include "../header/sphere_patches.h"
+#include "../header/sphere_mesh.h"
+#include "../header/profiler.h"
+
+#define PATCH_CONE_MARGIN 0.02f //radians added to each cone; morphing bends triangles between the two states
+
+static glm::vec3 triangle_normal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+	glm::vec3 normal = glm::cross(b - a, c - a);
+	float length = glm::length(normal);
+	return length > 0.0f ? normal / length : glm::vec3(0.0f);
+}
+
+//Bounding sphere around the box of every position the patch can take, and the cone around its triangle normals
+static void compute_patch_bounds(const sphere_mesh& mesh, const GLuint* indices, size_t index_count, sphere_patch* patch) {
+	bool morph = mesh.morph_targets.size() == mesh.positions.size();
+	glm::vec3 low(INFINITY), high(-INFINITY), axis(0.0f);
+	float radius = 0.0f, min_cos = 1.0f;
+	std::vector<glm::vec3> normals; //both passes over the normals need them; normalizing once halves the cost
+
+	for (size_t i = 0; i < index_count; i++) {
+		low = glm::min(low, mesh.positions[indices[i]]);
+		high = glm::max(high, mesh.positions[indices[i]]);
+		if (morph) {
+			low = glm::min(low, mesh.morph_targets[indices[i]]);
+			high = glm::max(high, mesh.morph_targets[indices[i]]);
+		}
+	}
+	patch->center = 0.5f * (low + high);
+	//square root is monotonic, so taking it once at the end gives the same radius
+	for (size_t i = 0; i < index_count; i++) {
+		glm::vec3 offset = mesh.positions[indices[i]] - patch->center;
+		radius = fmaxf(radius, glm::dot(offset, offset));
+		if (morph) {
+			offset = mesh.morph_targets[indices[i]] - patch->center;
+			radius = fmaxf(radius, glm::dot(offset, offset));
+		}
+	}
+	patch->radius = sqrtf(radius);
+
+	normals.reserve(morph ? 2 * index_count / 3 : index_count / 3);
+	for (size_t i = 0; i < index_count; i += 3) {
+		normals.push_back(triangle_normal(mesh.positions[indices[i]], mesh.positions[indices[i + 1]], mesh.positions[indices[i + 2]]));
+		axis += normals.back();
+		if (morph) {
+			normals.push_back(triangle_normal(mesh.morph_targets[indices[i]], mesh.morph_targets[indices[i + 1]], mesh.morph_targets[indices[i + 2]]));
+			axis += normals.back();
+		}
+	}
+	axis = glm::length(axis) > 0.0f ? glm::normalize(axis) : glm::vec3(0.0f, 1.0f, 0.0f);
+	for (size_t i = 0; i < normals.size(); i++)
+		min_cos = fminf(min_cos, glm::dot(axis, normals[i]));
+
+	float half_angle = acosf(fmaxf(-1.0f, fminf(1.0f, min_cos))) + PATCH_CONE_MARGIN;
+	patch->cone_axis = axis;
+	patch->cone_sin = sinf(fminf(half_angle, 1.5707963f));
+	patch->cone_cos = half_angle < 1.5707963f ? cosf(half_angle) : -1.0f;
+}
+
+void build_sphere_patches(sphere_mesh* mesh) {
+	PROFILE_ZONE("build_patches");
+	int n = sphere_divisions(mesh->level);
+	int grid = n < SPHERE_PATCH_GRID ? n : SPHERE_PATCH_GRID;
+	int rows_per_patch = n / grid;
+	std::vector<GLuint> reordered;
+
+	reordered.reserve(mesh->indices.size());
+	mesh->patches.clear();
+	for (int face = 0; face < 8; face++) {
+		for (int patch_row = 0; patch_row < grid; patch_row++) {
+			for (int patch_column = 0; patch_column <= patch_row; patch_column++) {
+				sphere_patch patch;
+				patch.first_index = uint32_t(reordered.size());
+
+				//triangle t of a row lies in lattice column t / 2, so each patch takes a run of every row
+				for (int row = patch_row * rows_per_patch; row < (patch_row + 1) * rows_per_patch; row++) {
+					size_t row_start = 3 * sphere_row_offset(face, row, n);
+					int first = 2 * patch_column * rows_per_patch;
+					int last = 2 * (patch_column + 1) * rows_per_patch - 1;
+					if (last > 2 * row)
+						last = 2 * row;
+					if (first <= last)
+						reordered.insert(reordered.end(), mesh->indices.begin() + row_start + 3 * first, mesh->indices.begin() + row_start + 3 * (last + 1));
+				}
+				patch.index_count = uint32_t(reordered.size() - patch.first_index);
+				patch.reserved = 0;
+				compute_patch_bounds(*mesh, reordered.data() + patch.first_index, patch.index_count, &patch);
+				mesh->patches.push_back(patch);
+			}
+		}
+	}
+	mesh->indices.swap(reordered);
+}
+
+void update_patch_bounds(const sphere_mesh& mesh, sphere_patch* patch) {
+	compute_patch_bounds(mesh, mesh.indices.data() + patch->first_index, patch->index_count, patch);
+}
+
+/*----- Culling -----*/
+//Gribb/Hartmann: each plane is a sum or difference of the matrix's last row with one of the others
+view_frustum extract_frustum(const glm::mat4& clip_from_model) {
+	view_frustum frustum;
+	glm::vec4 row[4];
+
+	for (int i = 0; i < 4; i++)
+		row[i] = glm::vec4(clip_from_model[0][i], clip_from_model[1][i], clip_from_model[2][i], clip_from_model[3][i]);
+	frustum.planes[0] = row[3] + row[0]; //left
+	frustum.planes[1] = row[3] - row[0]; //right
+	frustum.planes[2] = row[3] + row[1]; //bottom
+	frustum.planes[3] = row[3] - row[1]; //top
+	frustum.planes[4] = row[3] + row[2]; //near
+	frustum.planes[5] = row[3] - row[2]; //far
+	for (int i = 0; i < 6; i++)
+		frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+	return frustum;
+}
+
+/* Diagram of back face test
+	a triangle faces away when the angle between its normal and the view ray to it is under 90 degrees;
+	across the patch the ray direction varies by at most beta = asin(radius / distance) from center - eye and the
+	normals by the cone's half angle alpha, so the patch is hidden when angle(center - eye, axis) <= 90 - alpha - beta:
+		dot(center - eye, axis) >= sin(alpha) * sqrt(distance^2 - radius^2) + cos(alpha) * radius
+*/
+bool patch_visible(const sphere_patch& patch, const view_frustum& frustum, const glm::vec3& eye) {
+	glm::vec3 to_center = patch.center - eye;
+	float distance_squared = glm::dot(to_center, to_center);
+
+	for (int i = 0; i < 6; i++) {
+		if (glm::dot(glm::vec3(frustum.planes[i]), patch.center) + frustum.planes[i].w < -patch.radius)
+			return false;
+	}
+
+	if (patch.cone_cos <= 0.0f || distance_squared <= patch.radius * patch.radius)
+		return true;
+	//the bound needs alpha + beta <= 90 degrees, i.e. radius <= distance * cos(alpha)
+	if (patch.radius * patch.radius > distance_squared * patch.cone_cos * patch.cone_cos)
+		return true;
+	return glm::dot(to_center, patch.cone_axis) < patch.cone_sin * sqrtf(distance_squared - patch.radius * patch.radius) + patch.cone_cos * patch.radius;
+}
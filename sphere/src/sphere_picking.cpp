@@ -0,0 +1,217 @@
+#include <math.h>
+#include <vector>
+#include "../header/sphere_picking.h"
+#include "../header/sphere_kernels.h"
+
+#define PICK_GRAIN 64 //rays per parallel_for chunk
+
+pick_ray screen_ray(const glm::mat4& view, const glm::mat4& projection, double x, double y, float width, float height) {
+	glm::mat4 world_from_clip = glm::inverse(projection * view);
+	float ndc_x = float(2.0 * x / width - 1.0), ndc_y = float(1.0 - 2.0 * y / height);
+	glm::vec4 near_point = world_from_clip * glm::vec4(ndc_x, ndc_y, -1.0f, 1.0f);
+	glm::vec4 far_point = world_from_clip * glm::vec4(ndc_x, ndc_y, 1.0f, 1.0f);
+	pick_ray ray;
+
+	ray.origin = glm::vec3(near_point) / near_point.w;
+	ray.direction = glm::normalize(glm::vec3(far_point) / far_point.w - ray.origin);
+	return ray;
+}
+
+sphere_picker::sphere_picker(int level, double radius, const sphere_mesh* mesh)
+	: level(level), divisions(sphere_divisions(level)), radius(float(radius)), mesh(mesh) {
+	bounding_radius = this->radius;
+	if (mesh) {
+		for (size_t i = 0; i < mesh->positions.size(); i++)
+			bounding_radius = fmaxf(bounding_radius, glm::length(mesh->positions[i]));
+	}
+	//the widest triangles sit at the face centers; their planes are within half the lattice step of the sphere
+	float half_angle = 1.5707963f / divisions;
+	inscribed_radius = mesh ? 0.0f : this->radius * cosf(half_angle) * cosf(half_angle);
+}
+
+//Corner positions and mesh indices of one triangle
+void sphere_picker::triangle(int face, int row, int column, glm::vec3 corners[3], uint32_t indices[3]) const {
+	int points[3][3];
+	sphere_face_triangle_points(face, row, column, divisions, points);
+	for (int i = 0; i < 3; i++) {
+		indices[i] = sphere_lattice_index(points[i][0], points[i][1], points[i][2], divisions);
+		if (mesh && !mesh->vertex_remap.empty())
+			indices[i] = mesh->vertex_remap[indices[i]];
+		corners[i] = mesh ? mesh->positions[indices[i]] : glm::normalize(glm::vec3(float(points[i][0]), float(points[i][1]), float(points[i][2]))) * radius;
+	}
+}
+
+void sphere_picker::locate(const glm::vec3& direction, int divisions, int* face, int* row, int* column) {
+	sphere_lattice_locate(direction.x, direction.y, direction.z, divisions, face, row, column);
+}
+
+//Moller-Trumbore without culling, so rays starting inside the mesh still find the surface
+bool sphere_picker::test_triangle(const glm::vec3& origin, const glm::vec3& direction, int face, int row, int column, sphere_hit* hit) const {
+	glm::vec3 corner[3];
+	uint32_t corners[3];
+	triangle(face, row, column, corner, corners);
+	glm::vec3 a = corner[0], b = corner[1], c = corner[2];
+	glm::vec3 edge_ab = b - a, edge_ac = c - a;
+	glm::vec3 p = glm::cross(direction, edge_ac);
+	float determinant = glm::dot(edge_ab, p);
+
+	if (fabsf(determinant) < 1e-12f)
+		return false;
+	float inverse = 1.0f / determinant;
+	glm::vec3 s = origin - a;
+	float u = glm::dot(s, p) * inverse;
+	if (u < -PICK_EDGE_TOLERANCE || u > 1.0f + PICK_EDGE_TOLERANCE)
+		return false;
+	glm::vec3 q = glm::cross(s, edge_ab);
+	float v = glm::dot(direction, q) * inverse;
+	if (v < -PICK_EDGE_TOLERANCE || u + v > 1.0f + PICK_EDGE_TOLERANCE)
+		return false;
+	float t = glm::dot(edge_ac, q) * inverse;
+	if (t < 0.0f || (hit->hit && t >= hit->distance))
+		return false;
+
+	hit->hit = true;
+	hit->distance = t;
+	hit->barycentric = glm::vec3(1.0f - u - v, u, v);
+	hit->normal = glm::normalize(glm::cross(edge_ab, edge_ac));
+	hit->face = face;
+	hit->row = row;
+	hit->column = column;
+	hit->triangle = uint32_t(sphere_row_offset(face, row, divisions) + column);
+	for (int i = 0; i < 3; i++)
+		hit->vertices[i] = corners[i];
+	return true;
+}
+
+//The triangle and the ones sharing its edges inside the face; keeps the nearest hit
+bool sphere_picker::test_around(const glm::vec3& origin, const glm::vec3& direction, int face, int row, int column, sphere_hit* hit) const {
+	bool found = test_triangle(origin, direction, face, row, column, hit);
+	if (column > 0)
+		found |= test_triangle(origin, direction, face, row, column - 1, hit);
+	if (column < 2 * row)
+		found |= test_triangle(origin, direction, face, row, column + 1, hit);
+	if (column % 2 == 0 && row + 1 < divisions)
+		found |= test_triangle(origin, direction, face, row + 1, column + 1, hit);
+	if (column % 2 == 1)
+		found |= test_triangle(origin, direction, face, row - 1, column - 1, hit);
+	return found;
+}
+
+//Model space; [t_near, t_far] is where the ray is inside the bounding sphere
+bool sphere_picker::trace(const glm::vec3& origin, const glm::vec3& direction, float t_near, float t_far, sphere_hit* hit) const {
+	int face, row, column, last_face = -1, last_row = -1, last_column = -1;
+	float a = glm::dot(direction, direction), b = glm::dot(origin, direction);
+	float inner_discriminant = b * b - a * (glm::dot(origin, origin) - inscribed_radius * inscribed_radius);
+	float inner_near = INFINITY, inner_far = -INFINITY;
+
+	//the surface can only be where the ray is between the two spheres: [t_near, inner_near] and [inner_far, t_far]
+	if (inner_discriminant > 0.0f) {
+		inner_near = (-b - sqrtf(inner_discriminant)) / a;
+		inner_far = (-b + sqrtf(inner_discriminant)) / a;
+	}
+	float t = t_near > 0.0f ? t_near : (inner_near < 0.0f && inner_far > 0.0f ? inner_far : 0.0f);
+
+	hit->hit = false;
+	for (int step = 0; step < PICK_WALK_STEPS; step++) {
+		locate(origin + direction * t, divisions, &face, &row, &column);
+		if (face == last_face && row == last_row && column == last_column)
+			break;
+		if (test_around(origin, direction, face, row, column, hit))
+			return true;
+		last_face = face;
+		last_row = row;
+		last_column = column;
+
+		glm::vec3 corner[3];
+		uint32_t corners[3];
+		triangle(face, row, column, corner, corners);
+		glm::vec3 normal = glm::cross(corner[1] - corner[0], corner[2] - corner[0]);
+		float along = glm::dot(normal, direction);
+		if (fabsf(along) < 1e-12f)
+			break;
+		float plane_t = glm::dot(normal, corner[0] - origin) / along;
+		if (plane_t < 0.0f || plane_t > t_far)
+			break;
+		t = plane_t;
+	}
+
+	//grazing rays and rays from inside: march both stretches of the shell in quarter edge steps
+	float step_length = 0.25f * 1.5707963f * bounding_radius / divisions / sqrtf(a);
+	float stretches[2][2] = { { t_near, inner_near < t_far ? inner_near : t_far }, { inner_far > t_near ? inner_far : t_near, t_far } };
+	for (int i = 0; i < 2; i++) {
+		for (t = fmaxf(stretches[i][0], 0.0f); t <= stretches[i][1] + step_length; t += step_length) {
+			locate(origin + direction * t, divisions, &face, &row, &column);
+			if (face == last_face && row == last_row && column == last_column)
+				continue;
+			last_face = face;
+			last_row = row;
+			last_column = column;
+			if (test_around(origin, direction, face, row, column, hit))
+				return true;
+		}
+		if (inner_discriminant <= 0.0f)
+			break; //one stretch through the whole sphere
+	}
+	return false;
+}
+
+void sphere_picker::finish(const pick_ray& ray, const glm::mat4& model, sphere_hit* hit) const {
+	if (!hit->hit)
+		return;
+	hit->point = ray.origin + ray.direction * hit->distance;
+	hit->normal = glm::normalize(glm::mat3(glm::transpose(glm::inverse(model))) * hit->normal);
+}
+
+//An affine model matrix keeps the ray parameter, so distances found in model space hold in world space
+bool sphere_picker::pick(const pick_ray& ray, const glm::mat4& model, sphere_hit* hit) const {
+	glm::mat4 model_from_world = glm::inverse(model);
+	glm::vec3 origin = glm::vec3(model_from_world * glm::vec4(ray.origin, 1.0f));
+	glm::vec3 direction = glm::vec3(model_from_world * glm::vec4(ray.direction, 0.0f));
+	const float* origin_lanes[3] = { &origin.x, &origin.y, &origin.z };
+	const float* direction_lanes[3] = { &direction.x, &direction.y, &direction.z };
+	float t_near, t_far;
+
+	hit->hit = false;
+	ray_sphere_intersection(origin_lanes, direction_lanes, 1, bounding_radius, &t_near, &t_far);
+	if (t_far < 0.0f)
+		return false;
+	trace(origin, direction, t_near, t_far, hit);
+	finish(ray, model, hit);
+	return hit->hit;
+}
+
+void sphere_picker::pick(const pick_ray* rays, size_t count, const glm::mat4& model, sphere_hit* hits, thread_pool* pool) const {
+	glm::mat4 model_from_world = glm::inverse(model);
+	std::vector<float> lanes(8 * count);
+	float* origin[3] = { lanes.data(), lanes.data() + count, lanes.data() + 2 * count };
+	float* direction[3] = { lanes.data() + 3 * count, lanes.data() + 4 * count, lanes.data() + 5 * count };
+	float* t_near = lanes.data() + 6 * count;
+	float* t_far = lanes.data() + 7 * count;
+
+	//structure of arrays in model space, so the bounding sphere test runs a whole packet per instruction
+	for (size_t i = 0; i < count; i++) {
+		glm::vec3 o = glm::vec3(model_from_world * glm::vec4(rays[i].origin, 1.0f));
+		glm::vec3 d = glm::vec3(model_from_world * glm::vec4(rays[i].direction, 0.0f));
+		for (int axis = 0; axis < 3; axis++) {
+			origin[axis][i] = o[axis];
+			direction[axis][i] = d[axis];
+		}
+	}
+	const float* origin_lanes[3] = { origin[0], origin[1], origin[2] };
+	const float* direction_lanes[3] = { direction[0], direction[1], direction[2] };
+	ray_sphere_intersection(origin_lanes, direction_lanes, count, bounding_radius, t_near, t_far);
+
+	auto trace_range = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			hits[i].hit = false;
+			if (t_far[i] < 0.0f)
+				continue;
+			trace(glm::vec3(origin[0][i], origin[1][i], origin[2][i]), glm::vec3(direction[0][i], direction[1][i], direction[2][i]), t_near[i], t_far[i], &hits[i]);
+			finish(rays[i], model, &hits[i]);
+		}
+	};
+	if (pool)
+		pool->parallel_for(count, PICK_GRAIN, trace_range);
+	else
+		trace_range(0, count);
+}
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include "../header/streaming_buffer.h"
+#include "../header/gl_extensions.h"
+
+#define FENCE_TIMEOUT 1000000000ull //1 s per wait before warning; the wait continues afterwards
+
+streaming_buffer::streaming_buffer(size_t region_size, bool allow_persistent)
+	: VBO(0), region_size(region_size), persistent(allow_persistent && gl_extensions.buffer_storage != NULL), region(0), mapped(NULL) {
+	for (int i = 0; i < STREAMING_REGIONS; i++)
+		fences[i] = NULL;
+}
+streaming_buffer::~streaming_buffer() {
+	release();
+}
+
+void streaming_buffer::create() {
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glGenBuffers(1, &VBO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	if (!persistent) {
+		glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(region_size), NULL, GL_STREAM_DRAW);
+		return;
+	}
+	gl_extensions.buffer_storage(GL_ARRAY_BUFFER, GLsizeiptr(region_size * STREAMING_REGIONS), NULL, flags);
+	mapped = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, GLsizeiptr(region_size * STREAMING_REGIONS), flags);
+	if (mapped == NULL) {
+		fprintf(stderr, "Persistent mapping failed, streaming through orphaned buffers instead\n");
+		glDeleteBuffers(1, &VBO);
+		VBO = 0;
+		persistent = false;
+		create();
+	}
+}
+
+void* streaming_buffer::map() {
+	if (!VBO)
+		create();
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+	//orphaning hands the old storage to the driver, which keeps it alive until pending draws are done
+	if (!persistent) {
+		glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(region_size), NULL, GL_STREAM_DRAW);
+		return glMapBufferRange(GL_ARRAY_BUFFER, 0, GLsizeiptr(region_size), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	}
+
+	region = (region + 1) % STREAMING_REGIONS;
+	if (fences[region]) {
+		GLenum result = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+		while (result == GL_TIMEOUT_EXPIRED) {
+			fprintf(stderr, "Streaming buffer waited over a second for the GPU\n");
+			result = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+		}
+		glDeleteSync(fences[region]);
+		fences[region] = NULL;
+	}
+	return mapped + region * region_size;
+}
+GLintptr streaming_buffer::unmap() {
+	if (!persistent) {
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		return 0;
+	}
+	return GLintptr(region * region_size); //coherent mapping: nothing to flush
+}
+void streaming_buffer::fence() {
+	if (!persistent)
+		return;
+	if (fences[region])
+		glDeleteSync(fences[region]); //drawn again this frame; the newer fence covers both
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void streaming_buffer::release() {
+	for (int i = 0; i < STREAMING_REGIONS; i++) {
+		if (fences[i])
+			glDeleteSync(fences[i]);
+		fences[i] = NULL;
+	}
+	if (VBO) {
+		if (mapped) {
+			glBindBuffer(GL_ARRAY_BUFFER, VBO);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		}
+		glDeleteBuffers(1, &VBO);
+	}
+	VBO = 0;
+	mapped = NULL;
+}
@@ -0,0 +1,71 @@
+#include <math.h>
+#include "../header/tessellated_sphere.h"
+#include "../header/gl_extensions.h"
+#include "../header/uniform_buffer.h"
+#include "../header/gl_state.h"
+
+tessellated_sphere::tessellated_sphere(double radius, int base_level)
+	: radius(radius), base_level(base_level), target_edge_pixels(TESSELLATION_TARGET_EDGE_PIXELS), max_level(64.0f), program(NULL) {
+}
+tessellated_sphere::~tessellated_sphere() {
+	release();
+}
+
+bool tessellated_sphere::supported() {
+	return gl_extensions.patch_parameteri != NULL;
+}
+
+bool tessellated_sphere::create() {
+	const char* shader_paths[4] = { "src/shader/tess_vertex.glsl", "src/shader/tess_control.glsl", "src/shader/tess_evaluation.glsl", "src/shader/basic_fragment.glsl" };
+	const GLenum shader_types[4] = { GL_VERTEX_SHADER, GL_TESS_CONTROL_SHADER, GL_TESS_EVALUATION_SHADER, GL_FRAGMENT_SHADER };
+	sphere_mesh mesh;
+	GLint max_tess_level = 0;
+
+	if (!supported()) {
+		fprintf(stderr, "Tessellation shaders need OpenGL 4.0, found %d.%d\n", gl_extensions.version / 10, gl_extensions.version % 10);
+		return false;
+	}
+	//loaded without the blocking constructor, which would exit on a compile error; the reason is already printed
+	program = new shader_program();
+	program->bind_uniform_block("frame", FRAME_UNIFORM_BINDING);
+	program->load_async(shader_paths, shader_types, 4, NULL);
+	if (!program->wait()) {
+		release();
+		return false;
+	}
+	glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &max_tess_level);
+	if (max_tess_level > 0 && max_level > float(max_tess_level))
+		max_level = float(max_tess_level);
+
+	//the base mesh is tiny, so full floats cost nothing and keep the corners exactly on the sphere
+	generate_sphere_mesh(&mesh, base_level, radius);
+	buffer.layout = VERTEX_LAYOUT_PLANAR_PCN;
+	buffer.upload(mesh, program->ID);
+	return true;
+}
+
+size_t tessellated_sphere::draw(const glm::mat4& model, const glm::vec3& eye, float fov_y, float viewport_height) {
+	glm::vec3 eye_model = glm::vec3(glm::inverse(model) * glm::vec4(eye, 1.0f));
+
+	program->use();
+	program->set_mat4("model", model);
+	program->set_vec3("eye", eye_model);
+	program->set_float("sphere_radius", float(radius));
+	program->set_float("pixel_scale", viewport_height / (2.0f * tanf(0.5f * fov_y)));
+	program->set_float("target_edge_pixels", target_edge_pixels);
+	program->set_float("max_tess_level", max_level);
+
+	gl_extensions.patch_parameteri(GL_PATCH_VERTICES, 3);
+	buffer.draw(GL_PATCHES);
+	return size_t(buffer.index_count) / 3;
+}
+
+void tessellated_sphere::release() {
+	buffer.release();
+	if (program) {
+		glDeleteProgram(program->ID);
+		gl_state.program_deleted(program->ID);
+		delete program;
+		program = NULL;
+	}
+}
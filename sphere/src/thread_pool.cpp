@@ -0,0 +1,106 @@
+#include <atomic>
+#include <memory>
+#include "../header/thread_pool.h"
+
+thread_pool::thread_pool(unsigned thread_count) : stopping(false) {
+	if (thread_count == 0)
+		thread_count = std::thread::hardware_concurrency();
+	if (thread_count == 0)
+		thread_count = 1;
+	for (unsigned i = 1; i < thread_count; i++)
+		workers.emplace_back(&thread_pool::worker_loop, this);
+}
+thread_pool::~thread_pool() {
+	{
+		std::lock_guard<std::mutex> guard(task_lock);
+		stopping = true;
+	}
+	task_ready.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+unsigned thread_pool::size() const {
+	return unsigned(workers.size()) + 1;
+}
+
+void thread_pool::submit(std::function<void()> task) {
+	if (workers.empty()) {
+		task();
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> guard(task_lock);
+		tasks.push_back(std::move(task));
+	}
+	task_ready.notify_one();
+}
+
+void thread_pool::worker_loop() {
+	std::function<void()> task;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> guard(task_lock);
+			task_ready.wait(guard, [this] { return stopping || !tasks.empty(); });
+			if (stopping && tasks.empty())
+				return;
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+	}
+}
+
+//Progress shared between the caller and helper tasks; helpers that start late only touch this, never the caller's stack
+struct parallel_for_state {
+	std::atomic<size_t> next_chunk;
+	std::atomic<size_t> finished_chunks;
+	size_t chunk_count;
+	size_t count;
+	size_t grain;
+	std::function<void(size_t, size_t)> body;
+	std::mutex done_lock;
+	std::condition_variable done;
+};
+
+static void run_chunks(parallel_for_state* state) {
+	size_t chunk;
+	while ((chunk = state->next_chunk.fetch_add(1)) < state->chunk_count) {
+		size_t begin = chunk * state->grain;
+		size_t end = begin + state->grain < state->count ? begin + state->grain : state->count;
+		state->body(begin, end);
+		if (state->finished_chunks.fetch_add(1) + 1 == state->chunk_count) {
+			std::lock_guard<std::mutex> guard(state->done_lock);
+			state->done.notify_all();
+		}
+	}
+}
+
+void thread_pool::parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+	if (count == 0)
+		return;
+	if (grain == 0)
+		grain = 1;
+	size_t chunk_count = (count + grain - 1) / grain;
+	if (workers.empty() || chunk_count == 1) {
+		body(0, count);
+		return;
+	}
+
+	std::shared_ptr<parallel_for_state> state = std::make_shared<parallel_for_state>();
+	state->next_chunk = 0;
+	state->finished_chunks = 0;
+	state->chunk_count = chunk_count;
+	state->count = count;
+	state->grain = grain;
+	state->body = body;
+
+	size_t helpers = chunk_count - 1 < workers.size() ? chunk_count - 1 : workers.size();
+	for (size_t i = 0; i < helpers; i++)
+		submit([state] { run_chunks(state.get()); });
+
+	//caller works too, so nested calls from a worker cannot starve
+	run_chunks(state.get());
+	std::unique_lock<std::mutex> guard(state->done_lock);
+	state->done.wait(guard, [&state] { return state->finished_chunks.load() == state->chunk_count; });
+}
@@ -0,0 +1,27 @@
+#include <string.h>
+#include "../header/uniform_buffer.h"
+
+uniform_buffer::uniform_buffer(size_t size, GLuint binding) : UBO(0), binding(binding), shadow(size), uploaded(false) {}
+
+void uniform_buffer::update(const void* data) {
+	if (!UBO) {
+		glGenBuffers(1, &UBO);
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferData(GL_UNIFORM_BUFFER, GLsizeiptr(shadow.size()), NULL, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, binding, UBO);
+	}
+	if (uploaded && !memcmp(shadow.data(), data, shadow.size()))
+		return;
+
+	memcpy(shadow.data(), data, shadow.size());
+	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, GLsizeiptr(shadow.size()), shadow.data());
+	uploaded = true;
+}
+
+void uniform_buffer::release() {
+	if (UBO)
+		glDeleteBuffers(1, &UBO);
+	UBO = 0;
+	uploaded = false;
+}
@@ -0,0 +1,233 @@
+#include <math.h>
+#include <string.h>
+#include "../header/vertex_layout.h"
+#include "../header/sphere_mesh.h"
+
+#define ENCODE_GRAIN 4096 //vertices per parallel encode task
+
+struct attribute_format_info {
+	GLint components;
+	GLenum type;
+	GLboolean normalized;
+	size_t size;
+};
+
+static const attribute_format_info format_info[] = {
+	{ 3, GL_FLOAT, GL_FALSE, 12 }, //FORMAT_FLOAT3
+	{ 4, GL_FLOAT, GL_FALSE, 16 }, //FORMAT_FLOAT4
+	{ 4, GL_HALF_FLOAT, GL_FALSE, 8 }, //FORMAT_HALF4
+	{ 4, GL_SHORT, GL_TRUE, 8 }, //FORMAT_SNORM16x4
+	{ 2, GL_SHORT, GL_TRUE, 4 }, //FORMAT_OCTAHEDRAL16
+	{ 4, GL_UNSIGNED_BYTE, GL_TRUE, 4 } //FORMAT_UNORM8x4
+};
+
+static const char* attribute_name(const vertex_attribute& attribute) {
+	switch (attribute.source) {
+	case SOURCE_POSITION: return "vPosition";
+	case SOURCE_NORMAL: return attribute.format == FORMAT_OCTAHEDRAL16 ? "vNormalOct" : "vNormal";
+	case SOURCE_COLOR: return "vColor";
+	default: return "vMorph";
+	}
+}
+
+/*----- Scalar encoding -----*/
+//Round to nearest even; values below the smallest normal half flush to zero, which vertex data never needs
+uint16_t float_to_half(float value) {
+	uint32_t bits, sign, mantissa, half, rest;
+	int32_t exponent;
+
+	memcpy(&bits, &value, sizeof(bits));
+	sign = (bits >> 16) & 0x8000u;
+	exponent = int32_t((bits >> 23) & 0xffu) - 127 + 15;
+	mantissa = bits & 0x7fffffu;
+	if (exponent <= 0)
+		return uint16_t(sign);
+	if (exponent >= 31)
+		return uint16_t(sign | 0x7c00u);
+
+	half = sign | (uint32_t(exponent) << 10) | (mantissa >> 13);
+	rest = mantissa & 0x1fffu;
+	if (rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+		half++; //a carry out of the mantissa correctly bumps the exponent
+	return uint16_t(half);
+}
+static int16_t float_to_snorm16(float value) {
+	value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+	return int16_t(lrintf(value * 32767.0f));
+}
+static uint8_t float_to_unorm8(float value) {
+	value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+	return uint8_t(lrintf(value * 255.0f));
+}
+
+/* Diagram of octahedral encoding
+	the unit sphere is projected onto the octahedron |x| + |y| + |z| = 1 and flattened onto the xy plane;
+	the lower half (z < 0) is folded outwards over the diagonals so the whole sphere fills the [-1, 1] square
+*/
+static void encode_octahedral(const glm::vec3& normal, int16_t* out) {
+	float scale = 1.0f / (fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z));
+	float x = normal.x * scale, y = normal.y * scale;
+
+	if (normal.z < 0.0f) {
+		float folded_x = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float folded_y = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = folded_x;
+		y = folded_y;
+	}
+	out[0] = float_to_snorm16(x);
+	out[1] = float_to_snorm16(y);
+}
+
+static void encode_value(vertex_attribute_format format, const glm::vec4& value, unsigned char* out) {
+	switch (format) {
+	case FORMAT_FLOAT3:
+		memcpy(out, &value[0], sizeof(float) * 3);
+		break;
+	case FORMAT_FLOAT4:
+		memcpy(out, &value[0], sizeof(float) * 4);
+		break;
+	case FORMAT_HALF4: {
+		uint16_t half[4] = { float_to_half(value.x), float_to_half(value.y), float_to_half(value.z), float_to_half(1.0f) };
+		memcpy(out, half, sizeof(half));
+		break;
+	}
+	case FORMAT_SNORM16x4: {
+		int16_t snorm[4] = { float_to_snorm16(value.x), float_to_snorm16(value.y), float_to_snorm16(value.z), float_to_snorm16(value.w) };
+		memcpy(out, snorm, sizeof(snorm));
+		break;
+	}
+	case FORMAT_OCTAHEDRAL16: {
+		int16_t octahedral[2];
+		encode_octahedral(glm::vec3(value), octahedral);
+		memcpy(out, octahedral, sizeof(octahedral));
+		break;
+	}
+	case FORMAT_UNORM8x4:
+		out[0] = float_to_unorm8(value.x);
+		out[1] = float_to_unorm8(value.y);
+		out[2] = float_to_unorm8(value.z);
+		out[3] = float_to_unorm8(value.w);
+		break;
+	}
+}
+
+/*----- Vertex layout -----*/
+vertex_layout::vertex_layout(bool interleaved) : id(VERTEX_LAYOUT_CUSTOM), interleaved(interleaved), vertex_size(0) {}
+
+vertex_layout& vertex_layout::add(vertex_attribute_source source, vertex_attribute_format format) {
+	vertex_attribute attribute;
+	attribute.source = source;
+	attribute.format = format;
+	attribute.offset = vertex_size;
+	attributes.push_back(attribute);
+	vertex_size += format_info[format].size; //every format is a multiple of 4 bytes, keeping attributes aligned
+	id = VERTEX_LAYOUT_CUSTOM;
+	return *this;
+}
+bool vertex_layout::has(vertex_attribute_source source) const {
+	for (size_t i = 0; i < attributes.size(); i++) {
+		if (attributes[i].source == source)
+			return true;
+	}
+	return false;
+}
+size_t vertex_layout::buffer_size(size_t vertex_count) const {
+	return vertex_count * vertex_size;
+}
+
+//out holds span vertices starting at vertex base
+void vertex_layout::encode_range(const sphere_mesh& mesh, unsigned char* out, size_t begin, size_t end, size_t base, size_t span) const {
+	for (size_t a = 0; a < attributes.size(); a++) {
+		const vertex_attribute& attribute = attributes[a];
+		size_t size = format_info[attribute.format].size;
+		size_t start = interleaved ? attribute.offset : attribute.offset * span;
+		size_t step = interleaved ? vertex_size : size;
+
+		for (size_t i = begin; i < end; i++) {
+			glm::vec4 value;
+			switch (attribute.source) {
+			case SOURCE_POSITION: value = glm::vec4(mesh.positions[i], 1.0f); break;
+			case SOURCE_NORMAL: value = glm::vec4(mesh.normals[i], 0.0f); break;
+			case SOURCE_COLOR: value = mesh.colors[i]; break;
+			case SOURCE_MORPH: value = glm::vec4(mesh.morph_targets[i], 1.0f); break;
+			}
+			encode_value(attribute.format, value, out + start + (i - base) * step);
+		}
+	}
+}
+void vertex_layout::encode(const sphere_mesh& mesh, void* out, thread_pool* pool) const {
+	size_t vertex_count = mesh.positions.size();
+	unsigned char* bytes = (unsigned char*)out;
+
+	if (pool == NULL) {
+		encode_range(mesh, bytes, 0, vertex_count, 0, vertex_count);
+		return;
+	}
+	pool->parallel_for(vertex_count, ENCODE_GRAIN, [this, &mesh, bytes, vertex_count](size_t begin, size_t end) {
+		encode_range(mesh, bytes, begin, end, 0, vertex_count);
+	});
+}
+void vertex_layout::encode(const sphere_mesh& mesh, size_t begin, size_t end, void* out) const {
+	encode_range(mesh, (unsigned char*)out, begin, end, begin, end - begin);
+}
+
+void vertex_layout::setup(GLuint program_ID, size_t vertex_count) const {
+	static const char* vertex_inputs[] = { "vPosition", "vNormal", "vNormalOct", "vColor", "vMorph" };
+
+	//inputs this layout does not feed read their generic value; vNormal reads zero so the shader uses vNormalOct
+	for (size_t i = 0; i < sizeof(vertex_inputs) / sizeof(vertex_inputs[0]); i++) {
+		GLint location = glGetAttribLocation(program_ID, vertex_inputs[i]);
+		if (location < 0)
+			continue;
+		glDisableVertexAttribArray(location);
+		glVertexAttrib4f(location, 0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	for (size_t a = 0; a < attributes.size(); a++) {
+		const vertex_attribute& attribute = attributes[a];
+		const attribute_format_info& info = format_info[attribute.format];
+		GLint location = glGetAttribLocation(program_ID, attribute_name(attribute));
+		size_t start = interleaved ? attribute.offset : attribute.offset * vertex_count;
+
+		if (location < 0)
+			continue; //optimized out of this program
+		glVertexAttribPointer(location, info.components, info.type, info.normalized, GLsizei(interleaved ? vertex_size : info.size), (void*)start);
+		glEnableVertexAttribArray(location);
+	}
+}
+
+vertex_layout make_vertex_layout(vertex_layout_id id) {
+	vertex_layout layout(id != VERTEX_LAYOUT_PLANAR_PCN && id != VERTEX_LAYOUT_PLANAR_PCNM);
+
+	switch (id) {
+	case VERTEX_LAYOUT_PLANAR_PCN:
+	case VERTEX_LAYOUT_PLANAR_PCNM:
+		layout.add(SOURCE_POSITION, FORMAT_FLOAT3).add(SOURCE_COLOR, FORMAT_FLOAT4).add(SOURCE_NORMAL, FORMAT_FLOAT3);
+		if (id == VERTEX_LAYOUT_PLANAR_PCNM)
+			layout.add(SOURCE_MORPH, FORMAT_FLOAT3);
+		break;
+	case VERTEX_LAYOUT_COMPACT:
+	case VERTEX_LAYOUT_COMPACT_M:
+		layout.add(SOURCE_POSITION, FORMAT_HALF4).add(SOURCE_NORMAL, FORMAT_OCTAHEDRAL16).add(SOURCE_COLOR, FORMAT_UNORM8x4);
+		if (id == VERTEX_LAYOUT_COMPACT_M)
+			layout.add(SOURCE_MORPH, FORMAT_HALF4);
+		break;
+	default:
+		break;
+	}
+	layout.id = id;
+	return layout;
+}
+
+vertex_layout_id vertex_layout_with_morph(vertex_layout_id id, bool morph) {
+	switch (id) {
+	case VERTEX_LAYOUT_PLANAR_PCN:
+	case VERTEX_LAYOUT_PLANAR_PCNM:
+		return morph ? VERTEX_LAYOUT_PLANAR_PCNM : VERTEX_LAYOUT_PLANAR_PCN;
+	case VERTEX_LAYOUT_COMPACT:
+	case VERTEX_LAYOUT_COMPACT_M:
+		return morph ? VERTEX_LAYOUT_COMPACT_M : VERTEX_LAYOUT_COMPACT;
+	default:
+		return id;
+	}
+}